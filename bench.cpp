@@ -0,0 +1,531 @@
+/// Benchmark suite for the DeletableBloomFilter operations. For every filter
+/// kind, filter size, key length and key distribution, it fills a filter to its
+/// capacity and measures test (hit and miss), testBatch, add, testAndAdd and
+/// testAndRemove, reporting ns/op, ops/sec, LLC misses per op (when hardware
+/// counters are available) and the achieved false-positive rate. Results are
+/// printed as CSV or as JSON lines, one record per measurement.
+///
+/// The "numa" filter replicates the buckets on every NUMA node. Pinned to the
+/// node of the first replica, it measures test on that local replica
+/// ("test_hit_local", "test_miss_local") and on the replica of another node
+/// ("test_hit_remote", "test_miss_remote"), when the host has more than one.
+///
+/// Before the filters, the "hash" rows compare the cost of deriving the k
+/// bucket indices of an item with each hash scheme, for every key length.
+///
+/// Usage: bench [options]
+///   --filters LIST      Filters to run among the hash schemes seeded,
+///                       double, wyhash, crc32c, xxh3 (if available), siphash
+///                       and the blocked layout (default: all), and numa
+///                       (not run by default)
+///   --min-bits N        Smallest filter size in bits (default: 2^18, L1)
+///   --max-bits N        Largest filter size in bits (default: 2^30)
+///   --key-lengths LIST  Key lengths in bytes (default: 4,8,16,32,64,128,256)
+///   --dists LIST        Key distributions among uniform, zipf (default: both)
+///   --fp-rate P         Target false-positive rate (default: 0.001)
+///   --min-ops N         Minimum number of operations per measurement
+///                       (default: 2^20)
+///   --seed SEED         Seed of the filters, a number or "random" (default:
+///                       0, the unseeded layout). Comparing the siphash rows
+///                       with the others gives the cost of keyed hashing
+///   --format FORMAT     csv or json (default: csv)
+///   --hash-only         Only compare the hash schemes
+///   --quick             Short run: 2^18 and 2^24 bits, 8 and 64 byte keys
+
+#include "blocked-bf.h"
+#include "del-bf.h"
+#include "numa-bf.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/// Largest number of distinct keys measured per operation.
+#define POOL_SIZE (1 << 18)
+
+/// Skew of the Zipfian distribution.
+#define ZIPF_THETA (0.99)
+
+struct Options{
+    std::vector<std::string> filters = {"seeded", "double", "wyhash", "crc32c", "xxh3", "siphash", "blocked"};
+    uint64_t minBits = (uint64_t) 1 << 18;
+    uint64_t maxBits = (uint64_t) 1 << 30;
+    std::vector<int> keyLengths = {4, 8, 16, 32, 64, 128, 256};
+    std::vector<std::string> dists = {"uniform", "zipf"};
+    double fpRate = 0.001;
+    uint64_t minOps = (uint64_t) 1 << 20;
+    uint64_t seed = 0;
+    bool json = false;
+    bool hashOnly = false;
+};
+
+/// Parameters of the measurement being reported.
+struct Context{
+    const char* filter;
+    const char* dist;
+    uint64_t bits;
+    int keyLength;
+    uint64_t items;
+};
+
+/// Counts the LLC misses of the calling thread, if the kernel allows it.
+class MissCounter{
+private:
+    int fd;
+
+public:
+    MissCounter(){
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~MissCounter(){
+        if (fd >= 0){
+            close(fd);
+        }
+    }
+
+    void start(){
+        if (fd >= 0){
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    /// Returns the misses since start(), or -1 if they cannot be counted.
+    double stop(){
+        uint64_t misses;
+        if (fd < 0){
+            return -1;
+        }
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &misses, sizeof(misses)) != sizeof(misses)){
+            return -1;
+        }
+        return misses;
+    }
+};
+
+static uint64_t mix64(uint64_t x){
+    // fmix64, a bijection.
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/// Writes the len bytes of the key with the given id. Distinct ids below 2^32
+/// always give distinct keys.
+static void makeKey(uint64_t id, int len, char* out){
+    if (len < 8){
+        uint32_t x = (uint32_t) id * 0x9e3779b1u;
+        memcpy(out, &x, len < 4 ? len : 4);
+        for (int i = 4; i < len; i++){
+            out[i] = (char) (x >> (i * 8 % 32));
+        }
+        return;
+    }
+    uint64_t x = mix64(id);
+    for (int i = 0; i < len; i += 8){
+        memcpy(out + i, &x, len - i < 8 ? len - i : 8);
+        x = mix64(x + 0x9e3779b97f4a7c15ULL);
+    }
+}
+
+/// Zipfian generator of Gray et al. (Quickly Generating Billion-Record
+/// Synthetic Databases, 1994), returning ranks in [0, n).
+class Zipf{
+private:
+    uint64_t n;
+    double zetan, alpha, eta, half;
+
+public:
+    explicit Zipf(uint64_t n) : n(n){
+        zetan = 0;
+        for (uint64_t i = 1; i <= n; i++){
+            zetan += 1 / std::pow((double) i, ZIPF_THETA);
+        }
+        double zeta2 = 1 + std::pow(0.5, ZIPF_THETA);
+        alpha = 1 / (1 - ZIPF_THETA);
+        eta = (1 - std::pow(2.0 / n, 1 - ZIPF_THETA)) / (1 - zeta2 / zetan);
+        half = std::pow(0.5, ZIPF_THETA);
+    }
+
+    uint64_t next(double u){
+        double uz = u * zetan;
+        if (uz < 1){
+            return 0;
+        }
+        if (uz < 1 + half){
+            return 1;
+        }
+        uint64_t r = n * std::pow(eta * u - eta + 1, alpha);
+        return r < n ? r : n - 1;
+    }
+};
+
+/// A set of keys laid out contiguously.
+struct Pool{
+    std::vector<char> data;
+    std::vector<DeletableBloomFilter::Key> keys;
+    int len;
+
+    Pool(const std::vector<uint64_t>& ids, int len) : data(ids.size() * len), keys(ids.size()), len(len){
+        for (size_t i = 0; i < ids.size(); i++){
+            makeKey(ids[i], len, &data[i * len]);
+            keys[i].data = &data[i * len];
+            keys[i].len = len;
+        }
+    }
+
+    char* key(size_t i){
+        return &data[i * len];
+    }
+
+    size_t size() const{
+        return keys.size();
+    }
+};
+
+/// Returns count ids in [base, base + n), uniformly or Zipf distributed. The
+/// Zipf ranks are scrambled so that the hot keys are spread over the ids.
+static std::vector<uint64_t> sampleIds(uint64_t base, uint64_t n, size_t count,
+                                       Zipf* zipf, uint64_t seed){
+    std::vector<uint64_t> ids(count);
+    uint64_t state = seed;
+    for (size_t i = 0; i < count; i++){
+        state = mix64(state + 0x9e3779b97f4a7c15ULL);
+        if (zipf){
+            double u = (state >> 11) * (1.0 / 9007199254740992.0);
+            ids[i] = base + mix64(zipf->next(u)) % n;
+        }else{
+            ids[i] = base + state % n;
+        }
+    }
+    return ids;
+}
+
+static void report(const Options& opts, const Context& ctx, const char* op,
+                   uint64_t ops, double secs, double misses, double fpr){
+    double nsPerOp = secs * 1e9 / ops;
+    double missesPerOp = misses < 0 ? -1 : misses / ops;
+    if (opts.json){
+        printf("{\"filter\":\"%s\",\"op\":\"%s\",\"dist\":\"%s\",\"bits\":%lu,"
+               "\"key_len\":%d,\"items\":%lu,\"ops\":%lu,\"ns_per_op\":%.3f,"
+               "\"ops_per_sec\":%.0f,\"cache_misses_per_op\":",
+               ctx.filter, op, ctx.dist, (unsigned long) ctx.bits, ctx.keyLength,
+               (unsigned long) ctx.items, (unsigned long) ops, nsPerOp, 1e9 / nsPerOp);
+        missesPerOp < 0 ? printf("null") : printf("%.3f", missesPerOp);
+        printf(",\"fpr\":");
+        fpr < 0 ? printf("null") : printf("%.6g", fpr);
+        printf("}\n");
+    }else{
+        printf("%s,%s,%s,%lu,%d,%lu,%lu,%.3f,%.0f,", ctx.filter, op, ctx.dist,
+               (unsigned long) ctx.bits, ctx.keyLength, (unsigned long) ctx.items,
+               (unsigned long) ops, nsPerOp, 1e9 / nsPerOp);
+        missesPerOp < 0 ? printf("NA,") : printf("%.3f,", missesPerOp);
+        fpr < 0 ? printf("NA\n") : printf("%.6g\n", fpr);
+    }
+    fflush(stdout);
+}
+
+/// Runs op over the pool, as many times as needed to reach minOps, and
+/// reports the throughput. Returns the number of times op returned true.
+template <typename Op>
+static uint64_t measure(const Options& opts, const Context& ctx, const char* name,
+                        Pool& pool, Op op, bool reportFpr = false){
+    MissCounter counter;
+    uint64_t passes = (opts.minOps + pool.size() - 1) / pool.size();
+    uint64_t hits = 0;
+    counter.start();
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t p = 0; p < passes; p++){
+        for (size_t i = 0; i < pool.size(); i++){
+            hits += op(pool.key(i), pool.len);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double misses = counter.stop();
+    uint64_t ops = passes * pool.size();
+    report(opts, ctx, name, ops, std::chrono::duration<double>(end - start).count(),
+           misses, reportFpr ? (double) hits / ops : -1);
+    return hits;
+}
+
+/// Runs a mutating op over the pool on fresh copies of the filter, as many
+/// times as needed to reach minOps, and reports the throughput. The copies
+/// are not timed.
+template <typename Filter, typename Op>
+static void measureUpdate(const Options& opts, const Context& ctx, const char* name,
+                          const Filter& filled, Pool& pool, Op op){
+    MissCounter counter;
+    uint64_t passes = (opts.minOps + pool.size() - 1) / pool.size();
+    double secs = 0, misses = 0;
+    for (uint64_t p = 0; p < passes; p++){
+        Filter filter = filled;
+        counter.start();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < pool.size(); i++){
+            op(filter, pool.key(i), pool.len);
+        }
+        auto end = std::chrono::steady_clock::now();
+        double m = counter.stop();
+        misses = m < 0 || misses < 0 ? -1 : misses + m;
+        secs += std::chrono::duration<double>(end - start).count();
+    }
+    report(opts, ctx, name, passes * pool.size(), secs, misses, -1);
+}
+
+template <typename Filter, typename Make>
+static void benchFilter(const Options& opts, const char* name, Make make){
+    for (uint64_t bits = opts.minBits; bits <= opts.maxBits; bits *= 8){
+        // Capacity of a filter of about the requested number of bits.
+        uint64_t n = bits / ((double) DeletableBloomFilter::optimalM(1000000, opts.fpRate) / 1000000);
+        size_t poolSize = n < POOL_SIZE ? n : POOL_SIZE;
+        for (int len : opts.keyLengths){
+            Filter filled = make(n);
+            std::vector<char> key(len);
+            for (uint64_t id = 0; id < n; id++){
+                makeKey(id, len, key.data());
+                filled.add(key.data(), len);
+            }
+
+            for (const std::string& dist : opts.dists){
+                Context ctx = {name, dist.c_str(), bits, len, n};
+                Zipf* zipf = dist == "zipf" ? new Zipf(n) : NULL;
+                Pool present(sampleIds(0, n, poolSize, zipf, 1), len);
+                Pool absent(sampleIds(n, n, poolSize, zipf, 2), len);
+                delete zipf;
+
+                measure(opts, ctx, "test_hit", present, [&](char* d, int l){ return filled.test(d, l); });
+                measure(opts, ctx, "test_miss", absent, [&](char* d, int l){ return filled.test(d, l); }, true);
+                if constexpr (std::is_same<Filter, DeletableBloomFilter>::value){
+                    std::vector<uint8_t> results(poolSize);
+                    MissCounter counter;
+                    uint64_t passes = (opts.minOps + poolSize - 1) / poolSize;
+                    counter.start();
+                    auto start = std::chrono::steady_clock::now();
+                    for (uint64_t p = 0; p < passes; p++){
+                        filled.testBatch(absent.keys.data(), poolSize, results.data());
+                    }
+                    auto end = std::chrono::steady_clock::now();
+                    report(opts, ctx, "test_batch_miss", passes * poolSize,
+                           std::chrono::duration<double>(end - start).count(), counter.stop(), -1);
+                }
+                measureUpdate(opts, ctx, "add", filled, absent,
+                              [](Filter& f, char* d, int l){ f.add(d, l); });
+                measureUpdate(opts, ctx, "test_and_add", filled, absent,
+                              [](Filter& f, char* d, int l){ f.testAndAdd(d, l); });
+                measureUpdate(opts, ctx, "test_and_remove", filled, present,
+                              [](Filter& f, char* d, int l){ f.testAndRemove(d, l); });
+            }
+        }
+    }
+}
+
+/// Compares the lookups on the local replica of a NumaDeletableBloomFilter
+/// with those on the replica of another node.
+static void benchNuma(const Options& opts){
+    {
+        NumaDeletableBloomFilter probe(1, 1, opts.fpRate);
+        if (probe.getReplicas() == 1){
+            fprintf(stderr, "Single replica, no remote rows for numa\n");
+        }
+    }
+    for (uint64_t bits = opts.minBits; bits <= opts.maxBits; bits *= 8){
+        uint64_t n = bits / ((double) DeletableBloomFilter::optimalM(1000000, opts.fpRate) / 1000000);
+        size_t poolSize = n < POOL_SIZE ? n : POOL_SIZE;
+        for (int len : opts.keyLengths){
+            NumaDeletableBloomFilter filled(n, n / 16 + 1, opts.fpRate, HASH_SCHEME_SEEDED, false, opts.seed);
+            int node = filled.getReplicaNode(0);
+            if (node >= 0 && !NumaDeletableBloomFilter::runOnNode(node)){
+                fprintf(stderr, "Cannot run on node %d, the local rows may read another node\n", node);
+            }
+            std::vector<char> key(len);
+            for (uint64_t id = 0; id < n; id++){
+                makeKey(id, len, key.data());
+                filled.add(key.data(), len);
+            }
+
+            for (const std::string& dist : opts.dists){
+                Context ctx = {"numa", dist.c_str(), bits, len, n};
+                Zipf* zipf = dist == "zipf" ? new Zipf(n) : NULL;
+                Pool present(sampleIds(0, n, poolSize, zipf, 1), len);
+                Pool absent(sampleIds(n, n, poolSize, zipf, 2), len);
+                delete zipf;
+
+                measure(opts, ctx, "test_hit_local", present, [&](char* d, int l){ return filled.testReplica(0, d, l); });
+                measure(opts, ctx, "test_miss_local", absent, [&](char* d, int l){ return filled.testReplica(0, d, l); }, true);
+                if (filled.getReplicas() > 1){
+                    measure(opts, ctx, "test_hit_remote", present, [&](char* d, int l){ return filled.testReplica(1, d, l); });
+                    measure(opts, ctx, "test_miss_remote", absent, [&](char* d, int l){ return filled.testReplica(1, d, l); }, true);
+                }
+                // test() on the replica picked from the CPU of the thread.
+                measure(opts, ctx, "test_hit", present, [&](char* d, int l){ return filled.test(d, l); });
+            }
+        }
+    }
+}
+
+/// Returns the hash scheme with the given name, or -1.
+static int parseScheme(const std::string& name){
+    for (int s = HASH_SCHEME_SEEDED; hashSchemeName((HashScheme) s); s++){
+        if (name == hashSchemeName((HashScheme) s)){
+            return s;
+        }
+    }
+    return -1;
+}
+
+/// Measures the derivation of the k bucket indices of an item, for each
+/// hash scheme among the filters and each key length.
+static void benchHash(const Options& opts){
+    uint k = DeletableBloomFilter::optimalK(opts.fpRate);
+    uint64_t m = (uint64_t) 1 << 24;
+    std::vector<uint64_t> ids(POOL_SIZE);
+    for (size_t i = 0; i < ids.size(); i++){
+        ids[i] = i;
+    }
+    std::vector<uint64_t> idx(k);
+    for (const std::string& filter : opts.filters){
+        int s = parseScheme(filter);
+        if (s < 0 || !hashSchemeSupported((HashScheme) s)){
+            continue;
+        }
+        Indexer indexer(m, m / 64, k, (HashScheme) s, opts.seed);
+        for (int len : opts.keyLengths){
+            Pool pool(ids, len);
+            Context ctx = {filter.c_str(), "uniform", m, len, 0};
+            uint64_t sink = 0;
+            measure(opts, ctx, "hash", pool, [&](char* d, int l){
+                indexer.indices(d, l, idx.data());
+                sink += idx[k - 1];
+                return false;
+            });
+            if (sink == 1){
+                printf("\n");
+            }
+        }
+    }
+}
+
+template <typename T>
+static std::vector<T> parseList(const char* s, T (*parse)(const std::string&)){
+    std::vector<T> list;
+    std::string item;
+    for (const char* p = s;; p++){
+        if (*p == ',' || !*p){
+            if (!item.empty()){
+                list.push_back(parse(item));
+            }
+            item.clear();
+            if (!*p){
+                break;
+            }
+        }else{
+            item += *p;
+        }
+    }
+    return list;
+}
+
+static std::string parseString(const std::string& s){
+    return s;
+}
+
+static int parseInt(const std::string& s){
+    return atoi(s.c_str());
+}
+
+int main(int argc, char** argv){
+    Options opts;
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--hash-only"){
+            opts.hashOnly = true;
+            continue;
+        }
+        if (arg == "--quick"){
+            opts.maxBits = (uint64_t) 1 << 24;
+            opts.keyLengths = {8, 64};
+            opts.minOps = (uint64_t) 1 << 18;
+            continue;
+        }
+        if (arg == "--filters"){
+            opts.filters = parseList(value, parseString);
+        }else if (arg == "--min-bits"){
+            opts.minBits = strtoull(value, NULL, 10);
+        }else if (arg == "--max-bits"){
+            opts.maxBits = strtoull(value, NULL, 10);
+        }else if (arg == "--key-lengths"){
+            opts.keyLengths = parseList(value, parseInt);
+        }else if (arg == "--dists"){
+            opts.dists = parseList(value, parseString);
+        }else if (arg == "--fp-rate"){
+            opts.fpRate = atof(value);
+        }else if (arg == "--min-ops"){
+            opts.minOps = strtoull(value, NULL, 10);
+        }else if (arg == "--seed"){
+            opts.seed = !strcmp(value, "random") ? randomSeed() : strtoull(value, NULL, 0);
+        }else if (arg == "--format"){
+            opts.json = !strcmp(value, "json");
+        }else{
+            fprintf(stderr, "Unknown option %s, see the usage at the top of bench.cpp\n", argv[i]);
+            return 1;
+        }
+        i++;
+    }
+
+    if (!opts.json){
+        printf("filter,op,dist,bits,key_len,items,ops,ns_per_op,ops_per_sec,"
+               "cache_misses_per_op,fpr\n");
+    }
+    benchHash(opts);
+    if (opts.hashOnly){
+        return 0;
+    }
+    for (const std::string& filter : opts.filters){
+        double fpRate = opts.fpRate;
+        uint64_t seed = opts.seed;
+        int s = parseScheme(filter);
+        if (s >= 0){
+            if (!hashSchemeSupported((HashScheme) s)){
+                fprintf(stderr, "Skipping %s, not supported by this build\n", filter.c_str());
+                continue;
+            }
+            HashScheme hashScheme = (HashScheme) s;
+            benchFilter<DeletableBloomFilter>(opts, filter.c_str(), [=](uint64_t n){
+                return DeletableBloomFilter(n, n / 16 + 1, fpRate, hashScheme, false, seed);
+            });
+        }else if (filter == "numa"){
+            benchNuma(opts);
+        }else if (filter == "blocked"){
+            benchFilter<BlockedDeletableBloomFilter>(opts, filter.c_str(), [=](uint64_t n){
+                return BlockedDeletableBloomFilter(n, n / 16 + 1, fpRate, seed);
+            });
+        }else{
+            fprintf(stderr, "Unknown filter %s\n", filter.c_str());
+            return 1;
+        }
+    }
+}
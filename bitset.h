@@ -0,0 +1,302 @@
+/// Bitset is a fixed-size array of bits packed into 64-bit words. The words are
+/// allocated on a cache line boundary, so that the filters built on top of it
+/// can reason about which cache line a bit lives in, and they can be copied,
+/// OR-ed and counted a word at a time.
+
+#ifndef _BITSET_H_
+#define _BITSET_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#define BITSET_ALIGNMENT (64)
+
+/// Allocates the words of a bitset of the specified size on a cache line
+/// boundary, rounding the allocation up to a whole number of cache lines.
+inline void* allocateWords(size_t bits, size_t wordSize){
+    size_t numWords = (bits + 63) / 64;
+    if (!numWords){
+        return NULL;
+    }
+    size_t bytes = (numWords * wordSize + BITSET_ALIGNMENT - 1) &
+                   ~(size_t) (BITSET_ALIGNMENT - 1);
+    void* p;
+    if (posix_memalign(&p, BITSET_ALIGNMENT, bytes)){
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+class Bitset{
+private:
+    uint64_t* words; /// Bit data
+    size_t numWords; /// Number of allocated words
+    size_t size; /// Number of bits
+    bool owned; /// Whether the words were allocated by the bitset
+
+    void allocate(size_t bits){
+        size = bits;
+        numWords = (bits + 63) / 64;
+        words = (uint64_t*) allocateWords(bits, sizeof(uint64_t));
+        owned = true;
+    }
+
+public:
+    /// <summary>
+    /// Creates a bitset of the specified size, with all the bits cleared.
+    /// </summary>
+    /// <param name="bits">Number of bits</param>
+    explicit Bitset(size_t bits = 0){
+        allocate(bits);
+        reset();
+    }
+
+    Bitset(const Bitset& other){
+        allocate(other.size);
+        copyFrom(other);
+    }
+
+    Bitset(Bitset&& other) noexcept :
+            words(other.words), numWords(other.numWords), size(other.size),
+            owned(other.owned){
+        other.words = NULL;
+        other.numWords = 0;
+        other.size = 0;
+        other.owned = true;
+    }
+
+    Bitset& operator=(Bitset other) noexcept{
+        std::swap(words, other.words);
+        std::swap(numWords, other.numWords);
+        std::swap(size, other.size);
+        std::swap(owned, other.owned);
+        return *this;
+    }
+
+    ~Bitset(){
+        if (owned){
+            free(words);
+        }
+    }
+
+    /// <summary>
+    /// Creates a bitset backed by existing words, e.g. a memory-mapped file.
+    /// The words are neither copied nor freed, and must outlive the bitset.
+    /// Copies of the returned bitset own their words.
+    /// </summary>
+    /// <param name="words">The words, (bits + 63) / 64 of them</param>
+    /// <param name="bits">Number of bits</param>
+    static Bitset view(uint64_t* words, size_t bits){
+        Bitset b;
+        b.words = words;
+        b.numWords = (bits + 63) / 64;
+        b.size = bits;
+        b.owned = false;
+        return b;
+    }
+
+    /// <summary>
+    /// Returns the value of the i-th bit.
+    /// </summary>
+    bool get(size_t i) const{
+        return (words[i >> 6] >> (i & 63)) & 1;
+    }
+
+    /// <summary>
+    /// Sets the i-th bit.
+    /// </summary>
+    void set(size_t i){
+        words[i >> 6] |= (uint64_t) 1 << (i & 63);
+    }
+
+    /// <summary>
+    /// Clears the i-th bit.
+    /// </summary>
+    void clear(size_t i){
+        words[i >> 6] &= ~((uint64_t) 1 << (i & 63));
+    }
+
+    /// <summary>
+    /// Clears the i-th bit if cond is true, without branching on cond.
+    /// </summary>
+    void clearIf(size_t i, bool cond){
+        words[i >> 6] &= ~((uint64_t) cond << (i & 63));
+    }
+
+    /// <summary>
+    /// Sets the i-th bit and returns its previous value.
+    /// </summary>
+    bool testAndSet(size_t i){
+        uint64_t mask = (uint64_t) 1 << (i & 63);
+        uint64_t old = words[i >> 6];
+        words[i >> 6] = old | mask;
+        return (old & mask) != 0;
+    }
+
+    /// <summary>
+    /// Prefetches the word holding the i-th bit for reading.
+    /// </summary>
+    void prefetch(size_t i) const{
+        __builtin_prefetch(&words[i >> 6], 0);
+    }
+
+    /// <summary>
+    /// Prefetches the word holding the i-th bit for writing.
+    /// </summary>
+    void prefetchWrite(size_t i){
+        __builtin_prefetch(&words[i >> 6], 1);
+    }
+
+    /// <summary>
+    /// Clears all the bits.
+    /// </summary>
+    void reset(){
+        if (words){
+            memset(words, 0, numWords * sizeof(uint64_t));
+        }
+    }
+
+    /// <summary>
+    /// Copies the bits of a bitset of the same size.
+    /// </summary>
+    void copyFrom(const Bitset& other){
+        if (words){
+            memcpy(words, other.words, numWords * sizeof(uint64_t));
+        }
+    }
+
+    /// <summary>
+    /// ORs the bits of a bitset of the same size into this one.
+    /// </summary>
+    void orWith(const Bitset& other){
+        for (size_t i = 0; i < numWords; i++){
+            words[i] |= other.words[i];
+        }
+    }
+
+    /// <summary>
+    /// Returns the number of set bits.
+    /// </summary>
+    size_t popcount() const{
+        size_t c = 0;
+        for (size_t i = 0; i < numWords; i++){
+            c += __builtin_popcountll(words[i]);
+        }
+        return c;
+    }
+
+    /// <summary>
+    /// Returns the number of bits.
+    /// </summary>
+    size_t getSize() const{
+        return size;
+    }
+
+    /// <summary>
+    /// Returns the number of 64-bit words backing the bits.
+    /// </summary>
+    size_t getNumWords() const{
+        return numWords;
+    }
+
+    /// <summary>
+    /// Returns the words backing the bits. Bit i is bit (i % 64) of word i / 64.
+    /// </summary>
+    uint64_t* getWords(){
+        return words;
+    }
+
+    const uint64_t* getWords() const{
+        return words;
+    }
+};
+
+/// AtomicBitset is a Bitset whose words can be read and updated concurrently by
+/// multiple threads. Updates are atomic read-modify-write operations on the
+/// word holding the bit and are sequentially consistent, reads are relaxed.
+class AtomicBitset{
+private:
+    std::atomic<uint64_t>* words; /// Bit data
+    size_t numWords; /// Number of allocated words
+    size_t size; /// Number of bits
+
+public:
+    /// <summary>
+    /// Creates a bitset of the specified size, with all the bits cleared.
+    /// </summary>
+    /// <param name="bits">Number of bits</param>
+    explicit AtomicBitset(size_t bits = 0){
+        size = bits;
+        numWords = (bits + 63) / 64;
+        words = (std::atomic<uint64_t>*) allocateWords(bits, sizeof(std::atomic<uint64_t>));
+        for (size_t i = 0; i < numWords; i++){
+            new (&words[i]) std::atomic<uint64_t>(0);
+        }
+    }
+
+    AtomicBitset(const AtomicBitset&) = delete;
+    AtomicBitset& operator=(const AtomicBitset&) = delete;
+
+    ~AtomicBitset(){
+        free(words);
+    }
+
+    /// <summary>
+    /// Returns the value of the i-th bit.
+    /// </summary>
+    bool get(size_t i) const{
+        return (words[i >> 6].load(std::memory_order_relaxed) >> (i & 63)) & 1;
+    }
+
+    /// <summary>
+    /// Returns the value of the i-th bit, ordered with respect to the updates.
+    /// </summary>
+    bool getOrdered(size_t i) const{
+        return (words[i >> 6].load() >> (i & 63)) & 1;
+    }
+
+    /// <summary>
+    /// Sets the i-th bit and returns its previous value.
+    /// </summary>
+    bool testAndSet(size_t i){
+        uint64_t mask = (uint64_t) 1 << (i & 63);
+        return (words[i >> 6].fetch_or(mask) & mask) != 0;
+    }
+
+    /// <summary>
+    /// Sets the bits of mask in the w-th word and returns the previous value of
+    /// the word.
+    /// </summary>
+    uint64_t fetchOr(size_t w, uint64_t mask){
+        return words[w].fetch_or(mask);
+    }
+
+    /// <summary>
+    /// Clears the i-th bit.
+    /// </summary>
+    void clear(size_t i){
+        words[i >> 6].fetch_and(~((uint64_t) 1 << (i & 63)));
+    }
+
+    /// <summary>
+    /// Clears all the bits. Not atomic with respect to concurrent updates.
+    /// </summary>
+    void reset(){
+        for (size_t i = 0; i < numWords; i++){
+            words[i].store(0);
+        }
+    }
+
+    /// <summary>
+    /// Returns the number of bits.
+    /// </summary>
+    size_t getSize() const{
+        return size;
+    }
+};
+
+#endif // _BITSET_H_
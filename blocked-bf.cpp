@@ -0,0 +1,212 @@
+/// BlockedDeletableBloomFilter is a cache-line-blocked variant of the
+/// DeletableBloomFilter, see blocked-bf.h for the block layout.
+
+#include "blocked-bf.h"
+
+BlockedDeletableBloomFilter::BlockedDeletableBloomFilter(uint64_t n, uint64_t r, double fpRate, uint64_t seed) :
+        seed(seed){
+    uint64_t optM = DeletableBloomFilter::optimalM(n, fpRate);
+
+    numBlocks = (optM + BLOCK_BITS - 1) / BLOCK_BITS;
+    uint64_t regions = (r + numBlocks - 1) / numBlocks;
+    if (regions < 1){
+        regions = 1;
+    }else if (regions > 64){
+        regions = 64;
+    }
+    blockRegions = regions;
+    dataBits = BLOCK_BITS - blockRegions;
+    regionSize = Divisor((dataBits + blockRegions - 1) / blockRegions);
+    k = DeletableBloomFilter::optimalK(fpRate);
+    count = 0;
+    blocks = Bitset(numBlocks * BLOCK_BITS);
+}
+
+inline uint64_t BlockedDeletableBloomFilter::hashData(const char* data, int len, uint32_t* h){
+    MurmurHash128 h128 = MurmurHash3_x64_128(data, len, murmurSeed(seed));
+    h[0] = (uint32_t) h128.h2;
+    h[1] = (uint32_t) (h128.h2 >> 32);
+    return (uint64_t) (((unsigned __int128) h128.h1 * numBlocks) >> 64) * BLOCK_BITS;
+}
+
+inline uint BlockedDeletableBloomFilter::position(const uint32_t* h, uint i){
+    uint32_t x = h[0] + i * h[1] + (i * i * i - i) / 6;
+    return ((uint64_t) x * dataBits) >> 32;
+}
+
+/// <summary>
+/// Returns the number of items added to the filter.
+/// </summary>
+/// <returns>The number of items added to the filter</returns>
+uint64_t BlockedDeletableBloomFilter::getCount(){
+    return count;
+}
+
+/// <summary>
+/// Returns the seed of the hashes, to build another filter with the same
+/// bit positions.
+/// </summary>
+/// <returns>The seed of the filter</returns>
+uint64_t BlockedDeletableBloomFilter::getSeed(){
+    return seed;
+}
+
+/// <summary>
+/// Returns the number of collision regions, over all the blocks.
+/// </summary>
+/// <returns>The number of collision bits</returns>
+uint64_t BlockedDeletableBloomFilter::getRegions(){
+    return numBlocks * blockRegions;
+}
+
+/// <summary>
+/// Returns the number of collision regions marked as collided, whose
+/// buckets can no longer be cleared.
+/// </summary>
+/// <returns>The number of set collision bits</returns>
+uint64_t BlockedDeletableBloomFilter::getCollidedRegions(){
+    // The collision bits are the last blockRegions bits of each block.
+    const uint64_t* words = blocks.getWords();
+    uint64_t mask = blockRegions == 64 ? ~(uint64_t) 0 : (((uint64_t) 1 << blockRegions) - 1) << (64 - blockRegions);
+    uint64_t c = 0;
+    for (uint64_t b = 0; b < numBlocks; b++){
+        c += __builtin_popcountll(words[(b + 1) * (BLOCK_BITS / 64) - 1] & mask);
+    }
+    return c;
+}
+
+/// <summary>
+/// Will test for membership of the data and returns true if it is a member,
+/// false if not. This is a probabilistic test, meaning there is a non-zero
+/// probability of false positives but a zero probability of false negatives.
+/// </summary>
+/// <param name="data">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool BlockedDeletableBloomFilter::test(const char* data, int len){
+    uint32_t h[2];
+    uint64_t block = hashData(data, len, h);
+    // If any of the K bits are not set, then it's not a member.
+    for (uint i = 0; i < k; i++){
+        if (!blocks.get(block + position(h, i))){
+            return false;
+        }
+    }
+    return true;
+}
+
+/// <summary>
+/// Will add the data to the Bloom filter.
+/// </summary>
+/// <param name="data">The data to add.</param>
+void BlockedDeletableBloomFilter::add(const char* data, int len){
+    uint32_t h[2];
+    uint64_t block = hashData(data, len, h);
+    // Set the K bits.
+    for (uint i = 0; i < k; i++){
+        uint pos = position(h, i);
+        if (blocks.testAndSet(block + pos)){
+            // Collision, set corresponding region bit.
+            blocks.set(block + dataBits + regionSize.div(pos));
+        }
+    }
+    count++;
+}
+
+/// <summary>
+/// Is equivalent to calling Test followed by Add. It returns true if the data is
+/// a member, false if not.
+/// </summary>
+/// <param name="data">The data to test for and add if it doesn't exist.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool BlockedDeletableBloomFilter::testAndAdd(const char* data, int len){
+    bool member = true;
+    uint32_t h[2];
+    uint64_t block = hashData(data, len, h);
+    // If any of the K bits are not set, then it's not a member.
+    for (uint i = 0; i < k; i++){
+        uint pos = position(h, i);
+        if (!blocks.testAndSet(block + pos)){
+            member = false;
+        }else{
+            // Collision, set corresponding region bit.
+            blocks.set(block + dataBits + regionSize.div(pos));
+        }
+    }
+    count++;
+    return member;
+}
+
+/// <summary>
+/// Will test for membership of the data and remove it from the filter if it
+/// exists. Returns true if the data was a member, false if not.
+/// </summary>
+/// <param name="data">The data to test for and remove</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool BlockedDeletableBloomFilter::testAndRemove(const char* data, int len){
+    bool member = true;
+    uint32_t h[2];
+    uint64_t block = hashData(data, len, h);
+    for (uint i = 0; i < k; i++){
+        if (!blocks.get(block + position(h, i))){
+            member = false;
+        }
+    }
+
+    if (member){
+        for (uint i = 0; i < k; i++){
+            uint pos = position(h, i);
+            // Clear only bits located in collision-free zones.
+            blocks.clearIf(block + pos, !blocks.get(block + dataBits + regionSize.div(pos)));
+        }
+        count--;
+    }
+
+    return member;
+}
+
+/// <summary>
+/// Same as Test, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool BlockedDeletableBloomFilter::test(std::string_view key){
+    return test(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as Add, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to add.</param>
+void BlockedDeletableBloomFilter::add(std::string_view key){
+    add(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool BlockedDeletableBloomFilter::testAndAdd(std::string_view key){
+    return testAndAdd(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool BlockedDeletableBloomFilter::testAndRemove(std::string_view key){
+    return testAndRemove(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Restores the Bloom filter to its original state.
+/// </summary>
+void BlockedDeletableBloomFilter::reset(){
+    blocks.reset();
+    count = 0;
+}
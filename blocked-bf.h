@@ -0,0 +1,146 @@
+/// BlockedDeletableBloomFilter is a cache-line-blocked variant of the
+/// DeletableBloomFilter. The filter is split into 512-bit blocks, each one
+/// holding both its bucket bits and the collision bits of its own regions:
+///
+///   | bucket bits (512 - rb) | collision bits (rb) |
+///
+/// The first half of a single MurmurHash3_x64_128 selects the block, while the
+/// second half derives the k positions inside it by double hashing. Every
+/// operation therefore touches exactly one cache line, at the price of a
+/// slightly higher false-positive rate than the classic layout for the same
+/// number of bits.
+
+#ifndef _BLOCKED_BF_H_
+#define _BLOCKED_BF_H_
+
+#include "bitset.h"
+#include "del-bf.h"
+#include "hash.h"
+#include "indexer.h"
+
+#define BLOCK_BITS (512)
+
+class BlockedDeletableBloomFilter{
+private:
+    Bitset blocks; /// Filter data, one block per cache line
+    uint64_t numBlocks; /// Number of blocks
+    uint dataBits; /// Number of bucket bits in a block
+    uint blockRegions; /// Number of collision regions in a block
+    Divisor regionSize; /// Divides block offsets by the number of bits in a region
+    uint k; /// Number of hash functions
+    uint64_t count; /// Number of items in the filter
+    uint64_t seed; /// Seed of the hashes
+
+    /// Hashes the data and returns the bit offset of its block.
+    uint64_t hashData(const char* data, int len, uint32_t* h);
+
+    /// Returns the offset of the i-th bucket inside the block.
+    uint position(const uint32_t* h, uint i);
+
+public:
+    /// <summary>
+    /// Creates a new BlockedDeletableBloomFilter optimized to store n items with
+    /// a specified target false-positive rate. The r collision bits are spread
+    /// evenly across the blocks, with at least 1 and at most 64 per block.
+    /// </summary>
+    /// <param name="n">Number of items</param>
+    /// <param name="r">Number of bits to use to store collision information</param>
+    /// <param name="fpRate">Desired false positive rate</param>
+    /// <param name="seed">Seed of the hashes, see DeletableBloomFilter</param>
+    BlockedDeletableBloomFilter(uint64_t n, uint64_t r, double fpRate, uint64_t seed = 0);
+
+    /// <summary>
+    /// Returns the number of items added to the filter.
+    /// </summary>
+    /// <returns>The number of items added to the filter</returns>
+    uint64_t getCount();
+
+    /// <summary>
+    /// Returns the seed of the hashes, to build another filter with the same
+    /// bit positions.
+    /// </summary>
+    /// <returns>The seed of the filter</returns>
+    uint64_t getSeed();
+
+    /// <summary>
+    /// Returns the number of collision regions, over all the blocks.
+    /// </summary>
+    /// <returns>The number of collision bits</returns>
+    uint64_t getRegions();
+
+    /// <summary>
+    /// Returns the number of collision regions marked as collided, whose
+    /// buckets can no longer be cleared.
+    /// </summary>
+    /// <returns>The number of set collision bits</returns>
+    uint64_t getCollidedRegions();
+
+    /// <summary>
+    /// Will test for membership of the data and returns true if it is a member,
+    /// false if not. This is a probabilistic test, meaning there is a non-zero
+    /// probability of false positives but a zero probability of false negatives.
+    /// </summary>
+    /// <param name="data">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const char* data, int len);
+
+    /// <summary>
+    /// Will add the data to the Bloom filter.
+    /// </summary>
+    /// <param name="data">The data to add.</param>
+    void add(const char* data, int len);
+
+    /// <summary>
+    /// Is equivalent to calling Test followed by Add. It returns true if the data is
+    /// a member, false if not.
+    /// </summary>
+    /// <param name="data">The data to test for and add if it doesn't exist.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const char* data, int len);
+
+    /// <summary>
+    /// Will test for membership of the data and remove it from the filter if it
+    /// exists. Returns true if the data was a member, false if not.
+    /// </summary>
+    /// <param name="data">The data to test for and remove</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const char* data, int len);
+
+    /// <summary>
+    /// Same as Test, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(std::string_view key);
+
+    /// <summary>
+    /// Same as Add, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to add.</param>
+    void add(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(std::string_view key);
+
+    /// <summary>
+    /// Restores the Bloom filter to its original state.
+    /// </summary>
+    void reset();
+};
+
+#endif // _BLOCKED_BF_H_
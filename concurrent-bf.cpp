@@ -0,0 +1,492 @@
+/// ConcurrentDeletableBloomFilter is a lock-free DeletableBloomFilter, see
+/// concurrent-bf.h for its semantics under concurrency.
+
+#include "concurrent-bf.h"
+
+#include <algorithm>
+
+ConcurrentDeletableBloomFilter::ConcurrentDeletableBloomFilter(uint64_t n, uint64_t r, double fpRate,
+                                                               HashScheme hashScheme,
+                                                               bool powerOfTwo, uint64_t seed) :
+        buckets(powerOfTwo ? nextPowerOfTwo(DeletableBloomFilter::optimalM(n, fpRate) - r) :
+                DeletableBloomFilter::optimalM(n, fpRate) - r),
+        collisions(r){
+    indexer = Indexer(buckets.getSize(), r, DeletableBloomFilter::optimalK(fpRate), hashScheme, seed);
+}
+
+void ConcurrentDeletableBloomFilter::mergeBuckets(const uint64_t* hashes, size_t n){
+    uint64_t lastRegion = UINT64_MAX;
+    size_t i = 0;
+    while (i < n){
+        uint64_t word = hashes[i] / 64;
+        uint64_t mask = 0;
+        uint64_t repeated = 0;
+        for (; i < n && hashes[i] / 64 == word; i++){
+            uint64_t bit = (uint64_t) 1 << (hashes[i] % 64);
+            repeated |= mask & bit;
+            mask |= bit;
+        }
+        // A bucket collides if it was already set, or if several buffered
+        // probes hit it, as it would have been found set by all but the first.
+        uint64_t collided = (buckets.fetchOr(word, mask) & mask) | repeated;
+        if (!collided){
+            continue;
+        }
+        for (uint64_t c = collided; c; c &= c - 1){
+            uint64_t region = indexer.region(word * 64 + __builtin_ctzll(c));
+            // The indices are sorted, so are their regions.
+            if (region != lastRegion){
+                collisions.testAndSet(region);
+                lastRegion = region;
+            }
+        }
+        // Set the collided buckets again, as concurrentSetBucket does.
+        buckets.fetchOr(word, collided);
+    }
+}
+
+/// <summary>
+/// Returns the number of items added to the filter.
+/// </summary>
+/// <returns>The number of items added to the filter</returns>
+uint64_t ConcurrentDeletableBloomFilter::getCount(){
+    return count.get();
+}
+
+/// <summary>
+/// Returns the seed of the hashes, to build another filter with the same
+/// bucket indices.
+/// </summary>
+/// <returns>The seed of the filter</returns>
+uint64_t ConcurrentDeletableBloomFilter::getSeed(){
+    return indexer.getSeed();
+}
+
+template <typename Item>
+inline bool ConcurrentDeletableBloomFilter::testItem(Item& item){
+    uint k = indexer.getK();
+    // If any of the K bits are not set, then it's not a member.
+    for (uint i = 0; i < k; i++){
+        if (!buckets.get(itemIndex(indexer, item, i))){
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Item>
+inline void ConcurrentDeletableBloomFilter::addItem(Item& item){
+    uint k = indexer.getK();
+    // Set the K bits.
+    for (uint i = 0; i < k; i++){
+        concurrentSetBucket(buckets, collisions, indexer, itemIndex(indexer, item, i));
+    }
+    count.add(1);
+}
+
+template <typename Item>
+inline bool ConcurrentDeletableBloomFilter::testAndAddItem(Item& item){
+    bool member = true;
+    uint k = indexer.getK();
+    // If any of the K bits are not set, then it's not a member.
+    for (uint i = 0; i < k; i++){
+        if (!concurrentSetBucket(buckets, collisions, indexer, itemIndex(indexer, item, i))){
+            member = false;
+        }
+    }
+    count.add(1);
+    return member;
+}
+
+template <typename Item>
+inline bool ConcurrentDeletableBloomFilter::testAndRemoveItem(Item& item){
+    bool member = true;
+    uint k = indexer.getK();
+    for (uint i = 0; i < k; i++){
+        if (!buckets.get(itemIndex(indexer, item, i))){
+            member = false;
+        }
+    }
+
+    if (member){
+        for (uint i = 0; i < k; i++){
+            // Clear only bits located in collision-free zones.
+            concurrentClearBucket(buckets, collisions, indexer, itemIndex(indexer, item, i));
+        }
+        count.add(-1);
+    }
+
+    return member;
+}
+
+/// <summary>
+/// Will test for membership of the data and returns true if it is a member,
+/// false if not. This is a probabilistic test, meaning there is a non-zero
+/// probability of false positives but a zero probability of false negatives.
+/// </summary>
+/// <param name="data">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::test(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testItem(item);
+}
+
+/// <summary>
+/// Will add the data to the Bloom filter.
+/// </summary>
+/// <param name="data">The data to add.</param>
+void ConcurrentDeletableBloomFilter::add(const char* data, int len){
+    RawItem item(indexer, data, len);
+    addItem(item);
+}
+
+/// <summary>
+/// Is equivalent to calling Test followed by Add. It returns true if the data is
+/// a member, false if not.
+/// </summary>
+/// <param name="data">The data to test for and add if it doesn't exist.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::testAndAdd(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Will test for membership of the data and remove it from the filter if it
+/// exists. Returns true if the data was a member, false if not.
+/// </summary>
+/// <param name="data">The data to test for and remove</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool ConcurrentDeletableBloomFilter::testAndRemove(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testAndRemoveItem(item);
+}
+
+/// <summary>
+/// Same as Test, for a key hashed beforehand. Throws std::invalid_argument
+/// if the key was hashed with another scheme, or with fewer seeds than the
+/// filter has hash functions.
+/// </summary>
+/// <param name="key">The hashed data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::test(const HashedKey& key){
+    indexer.check(key);
+    return testItem(key);
+}
+
+/// <summary>
+/// Same as Add, for a key hashed beforehand. Throws std::invalid_argument as
+/// Test does.
+/// </summary>
+/// <param name="key">The hashed data to add.</param>
+void ConcurrentDeletableBloomFilter::add(const HashedKey& key){
+    indexer.check(key);
+    addItem(key);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key hashed beforehand. Throws
+/// std::invalid_argument as Test does.
+/// </summary>
+/// <param name="key">The hashed data to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::testAndAdd(const HashedKey& key){
+    indexer.check(key);
+    return testAndAddItem(key);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key hashed beforehand. Throws
+/// std::invalid_argument as Test does.
+/// </summary>
+/// <param name="key">The hashed data to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool ConcurrentDeletableBloomFilter::testAndRemove(const HashedKey& key){
+    indexer.check(key);
+    return testAndRemoveItem(key);
+}
+
+/// <summary>
+/// Same as Test, for a key split into n fragments, which are hashed in
+/// place with the same result as the contiguous key.
+/// </summary>
+/// <param name="fragments">The fragments of the data to search for.</param>
+/// <param name="n">Number of fragments.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::test(const KeyFragment* fragments, size_t n){
+    FragmentItem item(indexer, fragments, n);
+    return testItem(item);
+}
+
+/// <summary>
+/// Same as Add, for a key split into n fragments.
+/// </summary>
+/// <param name="fragments">The fragments of the data to add.</param>
+/// <param name="n">Number of fragments.</param>
+void ConcurrentDeletableBloomFilter::add(const KeyFragment* fragments, size_t n){
+    FragmentItem item(indexer, fragments, n);
+    addItem(item);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key split into n fragments.
+/// </summary>
+/// <param name="fragments">The fragments of the data to test for and add.</param>
+/// <param name="n">Number of fragments.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::testAndAdd(const KeyFragment* fragments, size_t n){
+    FragmentItem item(indexer, fragments, n);
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key split into n fragments.
+/// </summary>
+/// <param name="fragments">The fragments of the data to test for and remove.</param>
+/// <param name="n">Number of fragments.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool ConcurrentDeletableBloomFilter::testAndRemove(const KeyFragment* fragments, size_t n){
+    FragmentItem item(indexer, fragments, n);
+    return testAndRemoveItem(item);
+}
+
+/// <summary>
+/// Same as Test, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::test(std::string_view key){
+    RawItem item(indexer, key.data(), keyLength(key.size()));
+    return testItem(item);
+}
+
+/// <summary>
+/// Same as Add, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to add.</param>
+void ConcurrentDeletableBloomFilter::add(std::string_view key){
+    RawItem item(indexer, key.data(), keyLength(key.size()));
+    addItem(item);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::testAndAdd(std::string_view key){
+    RawItem item(indexer, key.data(), keyLength(key.size()));
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool ConcurrentDeletableBloomFilter::testAndRemove(std::string_view key){
+    RawItem item(indexer, key.data(), keyLength(key.size()));
+    return testAndRemoveItem(item);
+}
+
+/// <summary>
+/// Same as Test, for a 32-bit key, with the same result as its 4
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::test(uint32_t key){
+    IntItem<uint32_t> item(indexer, key);
+    return testItem(item);
+}
+
+/// <summary>
+/// Same as Add, for a 32-bit key, with the same result as its 4
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to add.</param>
+void ConcurrentDeletableBloomFilter::add(uint32_t key){
+    IntItem<uint32_t> item(indexer, key);
+    addItem(item);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a 32-bit key, with the same result as its 4
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::testAndAdd(uint32_t key){
+    IntItem<uint32_t> item(indexer, key);
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a 32-bit key, with the same result as its 4
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool ConcurrentDeletableBloomFilter::testAndRemove(uint32_t key){
+    IntItem<uint32_t> item(indexer, key);
+    return testAndRemoveItem(item);
+}
+
+/// <summary>
+/// Same as Test, for a 64-bit key, with the same result as its 8
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::test(uint64_t key){
+    IntItem<uint64_t> item(indexer, key);
+    return testItem(item);
+}
+
+/// <summary>
+/// Same as Add, for a 64-bit key, with the same result as its 8
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to add.</param>
+void ConcurrentDeletableBloomFilter::add(uint64_t key){
+    IntItem<uint64_t> item(indexer, key);
+    addItem(item);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a 64-bit key, with the same result as its 8
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool ConcurrentDeletableBloomFilter::testAndAdd(uint64_t key){
+    IntItem<uint64_t> item(indexer, key);
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a 64-bit key, with the same result as its 8
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool ConcurrentDeletableBloomFilter::testAndRemove(uint64_t key){
+    IntItem<uint64_t> item(indexer, key);
+    return testAndRemoveItem(item);
+}
+
+/// <summary>
+/// Restores the Bloom filter to its original state. Must not run
+/// concurrently with any other operation.
+/// </summary>
+void ConcurrentDeletableBloomFilter::reset(){
+    buckets.reset();
+    collisions.reset();
+    count.reset();
+}
+
+/// <summary>
+/// Creates an empty buffer for the filter.
+/// </summary>
+/// <param name="filter">The filter to add the items to</param>
+/// <param name="capacity">Number of items buffered before they are
+/// merged into the filter</param>
+ConcurrentDeletableBloomFilter::WriteBuffer::WriteBuffer(ConcurrentDeletableBloomFilter& filter, size_t capacity) :
+        filter(&filter), capacity(capacity ? capacity : 1), items(0){
+    buckets.reserve(this->capacity * filter.indexer.getK());
+}
+
+/// <summary>
+/// Merges the buffered items into the filter.
+/// </summary>
+ConcurrentDeletableBloomFilter::WriteBuffer::~WriteBuffer(){
+    flush();
+}
+
+template <typename Item>
+inline void ConcurrentDeletableBloomFilter::WriteBuffer::addItem(Item& item){
+    const Indexer& indexer = filter->indexer;
+    uint k = indexer.getK();
+    for (uint i = 0; i < k; i++){
+        buckets.push_back(itemIndex(indexer, item, i));
+    }
+    if (++items == capacity){
+        flush();
+    }
+}
+
+/// <summary>
+/// Will add the data to the buffer, and merge the buffer into the
+/// filter if it is full.
+/// </summary>
+/// <param name="data">The data to add.</param>
+void ConcurrentDeletableBloomFilter::WriteBuffer::add(const char* data, int len){
+    RawItem item(filter->indexer, data, len);
+    addItem(item);
+}
+
+/// <summary>
+/// Same as Add, for a key hashed beforehand. Throws
+/// std::invalid_argument if the key cannot be used with the filter.
+/// </summary>
+/// <param name="key">The hashed data to add.</param>
+void ConcurrentDeletableBloomFilter::WriteBuffer::add(const HashedKey& key){
+    filter->indexer.check(key);
+    addItem(key);
+}
+
+/// <summary>
+/// Same as Add, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to add.</param>
+void ConcurrentDeletableBloomFilter::WriteBuffer::add(std::string_view key){
+    RawItem item(filter->indexer, key.data(), keyLength(key.size()));
+    addItem(item);
+}
+
+/// <summary>
+/// Same as Add, for a 32-bit key hashed as its 4 little-endian bytes.
+/// </summary>
+/// <param name="key">The key to add.</param>
+void ConcurrentDeletableBloomFilter::WriteBuffer::add(uint32_t key){
+    IntItem<uint32_t> item(filter->indexer, key);
+    addItem(item);
+}
+
+/// <summary>
+/// Same as Add, for a 64-bit key hashed as its 8 little-endian bytes.
+/// </summary>
+/// <param name="key">The key to add.</param>
+void ConcurrentDeletableBloomFilter::WriteBuffer::add(uint64_t key){
+    IntItem<uint64_t> item(filter->indexer, key);
+    addItem(item);
+}
+
+/// <summary>
+/// Merges the buffered items into the filter: the bucket indices are
+/// sorted and every word is updated with a single fetch_or. Every Test
+/// that starts after Flush has returned sees the items.
+/// </summary>
+void ConcurrentDeletableBloomFilter::WriteBuffer::flush(){
+    if (!items){
+        return;
+    }
+    std::sort(buckets.begin(), buckets.end());
+    filter->mergeBuckets(buckets.data(), buckets.size());
+    filter->count.add(items);
+    buckets.clear();
+    items = 0;
+}
+
+/// <summary>
+/// Returns the number of items waiting in the buffer.
+/// </summary>
+/// <returns>The number of buffered items</returns>
+size_t ConcurrentDeletableBloomFilter::WriteBuffer::getPending(){
+    return items;
+}
@@ -0,0 +1,471 @@
+/// ConcurrentDeletableBloomFilter is a DeletableBloomFilter that can be used by
+/// multiple threads at the same time without any lock. It has the same layout
+/// as the DeletableBloomFilter built with the same parameters, but the buckets
+/// and the collision regions are updated with atomic fetch_or/fetch_and on
+/// their 64-bit words.
+///
+/// Semantics under concurrency:
+/// - Test, Add and TestAndAdd never lose an update: an item whose Add has
+///   returned is reported as a member by every Test that starts afterwards,
+///   unless the item itself is removed.
+/// - TestAndRemove only clears buckets located in collision-free regions. A
+///   bucket being cleared while a concurrent Add finds it already set is
+///   restored by whichever of the two observes the collision last, so once
+///   both operations have returned there are no false negatives. A Test
+///   running concurrently with them may however briefly miss that bucket.
+/// - The membership test of TestAndRemove is not atomic with its removal: two
+///   threads removing the same item can both succeed, decrementing the count
+///   twice. Callers needing an atomic test-and-remove must serialize the
+///   removals of the same item.
+/// - The count is kept in per-thread slots and is only exact once the filter
+///   is quiescent. Reset must not run concurrently with any other operation.
+///
+/// For insert bursts, each thread can add through its own WriteBuffer, which
+/// keeps the bucket indices of the items and merges them into the filter in
+/// word order, one fetch_or per word written. The buffered items are not
+/// visible to any Test, including those of the buffering thread, until the
+/// buffer is flushed: when it holds its capacity in items, on Flush and on its
+/// destruction. Once merged, the buckets and the collision regions are the same
+/// as if the items had been added one at a time.
+
+#ifndef _CONCURRENT_BF_H_
+#define _CONCURRENT_BF_H_
+
+#include "bitset.h"
+#include "del-bf.h"
+#include "indexer.h"
+
+#include <atomic>
+#include <vector>
+
+/// Number of slots the count is split into.
+#define COUNT_SLOTS (64)
+
+/// Default number of items a WriteBuffer holds before merging them.
+#define WRITE_BUFFER_ITEMS (1024)
+
+/// ConcurrentCount is the number of items of a concurrent filter. It is split
+/// into COUNT_SLOTS slots, each alone in its cache line, and every thread
+/// updates its own slot, so that concurrent updates do not contend on a line.
+/// The count is only exact once the filter is quiescent.
+class ConcurrentCount{
+private:
+    /// A slot of the count, alone in its cache line.
+    struct alignas(BITSET_ALIGNMENT) CountSlot{
+        std::atomic<int64_t> value;
+    };
+
+    CountSlot slots[COUNT_SLOTS]; /// Count, per thread
+
+public:
+    ConcurrentCount(){
+        reset();
+    }
+
+    /// <summary>
+    /// Adds n, which may be negative, to the slot of the calling thread.
+    /// </summary>
+    void add(int64_t n){
+        static std::atomic<uint> nextSlot(0);
+        thread_local uint slot = nextSlot.fetch_add(1) % COUNT_SLOTS;
+        slots[slot].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Returns the sum of the slots.
+    /// </summary>
+    uint64_t get() const{
+        int64_t c = 0;
+        for (uint i = 0; i < COUNT_SLOTS; i++){
+            c += slots[i].value.load(std::memory_order_relaxed);
+        }
+        return c;
+    }
+
+    /// <summary>
+    /// Sets the count to 0. Not atomic with respect to concurrent updates.
+    /// </summary>
+    void reset(){
+        for (uint i = 0; i < COUNT_SLOTS; i++){
+            slots[i].value.store(0);
+        }
+    }
+};
+
+/// Sets a bucket with the protocol of the concurrent filters, marking its
+/// region if the bucket was already set. Returns whether the bucket was
+/// already set. Buckets is an AtomicBitset, or any type with its testAndSet.
+template <typename Buckets>
+inline bool concurrentSetBucket(Buckets& buckets, AtomicBitset& collisions,
+                                const Indexer& indexer, uint64_t hash){
+    if (!buckets.testAndSet(hash)){
+        return false;
+    }
+    // Collision, set corresponding region bit. The bucket is then set again: a
+    // concurrent TestAndRemove may have checked the region before it was marked
+    // and cleared the bucket after our first fetch_or.
+    collisions.testAndSet(indexer.region(hash));
+    buckets.testAndSet(hash);
+    return true;
+}
+
+/// Clears a bucket with the protocol of the concurrent filters, if its region
+/// is collision-free. Buckets is an AtomicBitset, or any type with its
+/// testAndSet and clear.
+template <typename Buckets>
+inline void concurrentClearBucket(Buckets& buckets, AtomicBitset& collisions,
+                                  const Indexer& indexer, uint64_t hash){
+    uint64_t region = indexer.region(hash);
+    // If a concurrent Add found the bucket set and marked the region in the
+    // meantime, the bucket is shared and must be restored.
+    if (!collisions.getOrdered(region)){
+        buckets.clear(hash);
+        if (collisions.getOrdered(region)){
+            buckets.testAndSet(hash);
+        }
+    }
+}
+
+class ConcurrentDeletableBloomFilter{
+private:
+    AtomicBitset buckets; /// Filter data
+    AtomicBitset collisions; /// Filter collision data
+    Indexer indexer; /// Maps items onto buckets and buckets onto regions
+    ConcurrentCount count; /// Number of items in the filter
+
+    /// Sets the buckets of n sorted indices, with one fetch_or per word, and
+    /// marks the regions of the buckets that were already set or that appear
+    /// more than once.
+    void mergeBuckets(const uint64_t* hashes, size_t n);
+
+    /// Operations on an item, a RawItem, a FragmentItem, an IntItem or a HashedKey.
+    template <typename Item> bool testItem(Item& item);
+    template <typename Item> void addItem(Item& item);
+    template <typename Item> bool testAndAddItem(Item& item);
+    template <typename Item> bool testAndRemoveItem(Item& item);
+
+public:
+    /// WriteBuffer is a handle through which one thread adds items to the
+    /// filter in batches. It must not outlive the filter, and the filter must
+    /// not be Reset while it holds items.
+    class WriteBuffer{
+    private:
+        ConcurrentDeletableBloomFilter* filter; /// Filter written
+        std::vector<uint64_t> buckets; /// Bucket indices of the buffered items
+        size_t capacity; /// Number of items merged at a time
+        size_t items; /// Number of buffered items
+
+        /// Buffers the bucket indices of an item.
+        template <typename Item> void addItem(Item& item);
+
+    public:
+        /// <summary>
+        /// Creates an empty buffer for the filter.
+        /// </summary>
+        /// <param name="filter">The filter to add the items to</param>
+        /// <param name="capacity">Number of items buffered before they are
+        /// merged into the filter</param>
+        explicit WriteBuffer(ConcurrentDeletableBloomFilter& filter, size_t capacity = WRITE_BUFFER_ITEMS);
+
+        WriteBuffer(const WriteBuffer&) = delete;
+        WriteBuffer& operator=(const WriteBuffer&) = delete;
+
+        /// <summary>
+        /// Merges the buffered items into the filter.
+        /// </summary>
+        ~WriteBuffer();
+
+        /// <summary>
+        /// Will add the data to the buffer, and merge the buffer into the
+        /// filter if it is full.
+        /// </summary>
+        /// <param name="data">The data to add.</param>
+        void add(const char* data, int len);
+
+        /// <summary>
+        /// Same as Add, for a key hashed beforehand. Throws
+        /// std::invalid_argument if the key cannot be used with the filter.
+        /// </summary>
+        /// <param name="key">The hashed data to add.</param>
+        void add(const HashedKey& key);
+
+        /// <summary>
+        /// Same as Add, for a key given as a string_view. Throws
+        /// std::invalid_argument if it is longer than INT_MAX bytes.
+        /// </summary>
+        /// <param name="key">The data to add.</param>
+        void add(std::string_view key);
+
+        /// <summary>
+        /// Same as Add, for a 32-bit key hashed as its 4 little-endian bytes.
+        /// </summary>
+        /// <param name="key">The key to add.</param>
+        void add(uint32_t key);
+
+        /// <summary>
+        /// Same as Add, for a 64-bit key hashed as its 8 little-endian bytes.
+        /// </summary>
+        /// <param name="key">The key to add.</param>
+        void add(uint64_t key);
+
+        /// <summary>
+        /// Merges the buffered items into the filter: the bucket indices are
+        /// sorted and every word is updated with a single fetch_or. Every Test
+        /// that starts after Flush has returned sees the items.
+        /// </summary>
+        void flush();
+
+        /// <summary>
+        /// Returns the number of items waiting in the buffer.
+        /// </summary>
+        /// <returns>The number of buffered items</returns>
+        size_t getPending();
+    };
+
+    /// <summary>
+    /// Creates a new ConcurrentDeletableBloomFilter optimized to store n items
+    /// with a specified target false-positive rate, see DeletableBloomFilter.
+    /// </summary>
+    /// <param name="n">Number of items</param>
+    /// <param name="r">Number of bits to use to store collision information</param>
+    /// <param name="fpRate">Desired false positive rate</param>
+    /// <param name="hashScheme">Scheme used to derive the bucket indices</param>
+    /// <param name="powerOfTwo">Whether to round the number of buckets up to a
+    /// power of two, so that bucket indices are reduced with a mask. Regions
+    /// are then indexed with a shift as well if r is a power of two.</param>
+    /// <param name="seed">Seed of the hashes, 0 for the original layout. A
+    /// secret seed, such as randomSeed(), with HASH_SCHEME_SIPHASH keeps
+    /// attackers from crafting colliding keys. Filters that exchange
+    /// HashedKeys, or a filter rebuilt from the same items, must use the same
+    /// seed, see getSeed().</param>
+    ConcurrentDeletableBloomFilter(uint64_t n, uint64_t r, double fpRate,
+                                   HashScheme hashScheme = HASH_SCHEME_SEEDED,
+                                   bool powerOfTwo = false, uint64_t seed = 0);
+
+    /// <summary>
+    /// Returns the number of items added to the filter.
+    /// </summary>
+    /// <returns>The number of items added to the filter</returns>
+    uint64_t getCount();
+
+    /// <summary>
+    /// Returns the seed of the hashes, to build another filter with the same
+    /// bucket indices.
+    /// </summary>
+    /// <returns>The seed of the filter</returns>
+    uint64_t getSeed();
+
+    /// <summary>
+    /// Will test for membership of the data and returns true if it is a member,
+    /// false if not. This is a probabilistic test, meaning there is a non-zero
+    /// probability of false positives but a zero probability of false negatives.
+    /// </summary>
+    /// <param name="data">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const char* data, int len);
+
+    /// <summary>
+    /// Will add the data to the Bloom filter.
+    /// </summary>
+    /// <param name="data">The data to add.</param>
+    void add(const char* data, int len);
+
+    /// <summary>
+    /// Is equivalent to calling Test followed by Add. It returns true if the data is
+    /// a member, false if not.
+    /// </summary>
+    /// <param name="data">The data to test for and add if it doesn't exist.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const char* data, int len);
+
+    /// <summary>
+    /// Will test for membership of the data and remove it from the filter if it
+    /// exists. Returns true if the data was a member, false if not.
+    /// </summary>
+    /// <param name="data">The data to test for and remove</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const char* data, int len);
+
+    /// <summary>
+    /// Same as Test, for a key hashed beforehand. Throws std::invalid_argument
+    /// if the key was hashed with another scheme, or with fewer seeds than the
+    /// filter has hash functions.
+    /// </summary>
+    /// <param name="key">The hashed data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const HashedKey& key);
+
+    /// <summary>
+    /// Same as Add, for a key hashed beforehand. Throws std::invalid_argument as
+    /// Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to add.</param>
+    void add(const HashedKey& key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key hashed beforehand. Throws
+    /// std::invalid_argument as Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const HashedKey& key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key hashed beforehand. Throws
+    /// std::invalid_argument as Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const HashedKey& key);
+
+    /// <summary>
+    /// Same as Test, for a key split into n fragments, which are hashed in
+    /// place with the same result as the contiguous key.
+    /// </summary>
+    /// <param name="fragments">The fragments of the data to search for.</param>
+    /// <param name="n">Number of fragments.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const KeyFragment* fragments, size_t n);
+
+    /// <summary>
+    /// Same as Add, for a key split into n fragments.
+    /// </summary>
+    /// <param name="fragments">The fragments of the data to add.</param>
+    /// <param name="n">Number of fragments.</param>
+    void add(const KeyFragment* fragments, size_t n);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key split into n fragments.
+    /// </summary>
+    /// <param name="fragments">The fragments of the data to test for and add.</param>
+    /// <param name="n">Number of fragments.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const KeyFragment* fragments, size_t n);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key split into n fragments.
+    /// </summary>
+    /// <param name="fragments">The fragments of the data to test for and remove.</param>
+    /// <param name="n">Number of fragments.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const KeyFragment* fragments, size_t n);
+
+    /// <summary>
+    /// Same as Test, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(std::string_view key);
+
+    /// <summary>
+    /// Same as Add, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to add.</param>
+    void add(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(std::string_view key);
+
+    /// <summary>
+    /// Same as Test, for a 32-bit key, with the same result as its 4
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(uint32_t key);
+
+    /// <summary>
+    /// Same as Add, for a 32-bit key, with the same result as its 4
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to add.</param>
+    void add(uint32_t key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a 32-bit key, with the same result as its 4
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(uint32_t key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a 32-bit key, with the same result as its 4
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(uint32_t key);
+
+    /// <summary>
+    /// Same as Test, for a 64-bit key, with the same result as its 8
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(uint64_t key);
+
+    /// <summary>
+    /// Same as Add, for a 64-bit key, with the same result as its 8
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to add.</param>
+    void add(uint64_t key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a 64-bit key, with the same result as its 8
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(uint64_t key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a 64-bit key, with the same result as its 8
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(uint64_t key);
+
+#ifdef __cpp_lib_span
+    /// <summary>
+    /// Same as the string_view overloads, for a key given as bytes.
+    /// </summary>
+    bool test(std::span<const std::byte> key){
+        return test(std::string_view((const char*) key.data(), key.size()));
+    }
+    void add(std::span<const std::byte> key){
+        add(std::string_view((const char*) key.data(), key.size()));
+    }
+    bool testAndAdd(std::span<const std::byte> key){
+        return testAndAdd(std::string_view((const char*) key.data(), key.size()));
+    }
+    bool testAndRemove(std::span<const std::byte> key){
+        return testAndRemove(std::string_view((const char*) key.data(), key.size()));
+    }
+#endif
+
+    /// <summary>
+    /// Restores the Bloom filter to its original state. Must not run
+    /// concurrently with any other operation.
+    /// </summary>
+    void reset();
+};
+
+#endif // _CONCURRENT_BF_H_
@@ -0,0 +1,85 @@
+/// Prints the false-positive rate and the deletability of the classic and of
+/// the blocked layout as the filters fill up, as CSV. The deletability is the
+/// fraction of the inserted items that can actually be removed, i.e. that have
+/// at least one bit in a collision-free region.
+///
+/// With "large", it instead fills a classic filter of about the given number
+/// of bits to its capacity and compares its false-positive rate with the
+/// target, to validate filters larger than 2^32 bits.
+///
+/// Usage: curves [items] [r] [fpRate]
+///        curves large [bits] [fpRate]
+
+#include "blocked-bf.h"
+#include "del-bf.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define PROBES (200000)
+
+template <typename Filter>
+static void curve(const char* layout, uint n, uint r, double fpRate){
+    for (uint load = 10; load <= 200; load += 10){
+        Filter filter(n, r, fpRate);
+        uint items = (uint64_t) n * load / 100;
+        uint64_t x;
+        for (uint i = 0; i < items; i++){
+            x = 2 * (uint64_t) i;
+            filter.add((char*) &x, sizeof(x));
+        }
+
+        uint fp = 0;
+        for (uint i = 0; i < PROBES; i++){
+            x = 2 * (uint64_t) i + 1;
+            fp += filter.test((char*) &x, sizeof(x));
+        }
+
+        // A removed item can only clear bits it does not share with any other
+        // item, so removals do not affect each other's deletability.
+        uint deleted = 0;
+        for (uint i = 0; i < items; i++){
+            x = 2 * (uint64_t) i;
+            filter.testAndRemove((char*) &x, sizeof(x));
+            deleted += !filter.test((char*) &x, sizeof(x));
+        }
+
+        printf("%s,%.2f,%.6f,%.4f\n", layout, load / 100.0, (double) fp / PROBES,
+               items ? (double) deleted / items : 1.0);
+    }
+}
+
+static void large(uint64_t bits, double fpRate){
+    // Number of items for which optimalM returns about the requested bits.
+    uint64_t n = bits / ((double) DeletableBloomFilter::optimalM(1000000, fpRate) / 1000000);
+    DeletableBloomFilter dbf(n, n / 16, fpRate, HASH_SCHEME_DOUBLE);
+    uint64_t x;
+    for (uint64_t i = 0; i < n; i++){
+        x = 2 * i;
+        dbf.add((char*) &x, sizeof(x));
+    }
+    uint64_t fp = 0, probes = 10 * (uint64_t) PROBES;
+    for (uint64_t i = 0; i < probes; i++){
+        x = 2 * i + 1;
+        fp += dbf.test((char*) &x, sizeof(x));
+    }
+    printf("bits,items,target,fpr\n");
+    printf("%lu,%lu,%g,%g\n", (unsigned long) DeletableBloomFilter::optimalM(n, fpRate),
+           (unsigned long) n, fpRate, (double) fp / probes);
+}
+
+int main(int argc, char** argv){
+    if (argc > 1 && !strcmp(argv[1], "large")){
+        large(argc > 2 ? strtoull(argv[2], NULL, 10) : (uint64_t) 5 << 30,
+              argc > 3 ? atof(argv[3]) : 1e-4);
+        return 0;
+    }
+    uint n = argc > 1 ? atoi(argv[1]) : 100000;
+    uint r = argc > 2 ? atoi(argv[2]) : n / 2;
+    double fpRate = argc > 3 ? atof(argv[3]) : 0.01;
+
+    printf("layout,load,fpr,deletability\n");
+    curve<DeletableBloomFilter>("classic", n, r, fpRate);
+    curve<BlockedDeletableBloomFilter>("blocked", n, r, fpRate);
+}
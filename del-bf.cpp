@@ -8,116 +8,126 @@
 
 #include "del-bf.h"
 
-DeletableBloomFilter::DeletableBloomFilter(uint n, uint r, double fpRate){
-    uint optM = optimalM(n, fpRate);
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+DeletableBloomFilter::DeletableBloomFilter(uint64_t n, uint64_t r, double fpRate,
+                                           HashScheme hashScheme, bool powerOfTwo, uint64_t seed){
+    uint64_t optM = optimalM(n, fpRate);
     uint optK = optimalK(fpRate);
+    uint64_t m = powerOfTwo ? nextPowerOfTwo(optM - r) : optM - r;
 
-    buckets = std::vector<bool>(optM - r);
-    collisions = std::vector<bool>(r);
-    m = optM - r;
-    regionSize = (optM - r) / r;
-    k = optK;
+    buckets = Bitset(m);
+    collisions = Bitset(r);
+    indexer = Indexer(m, r, optK, hashScheme, seed);
+    count = 0;
 }
 
 /// <summary>
 /// Returns the number of items added to the filter.
 /// </summary>
 /// <returns>The number of items added to the filter</returns>
-uint DeletableBloomFilter::getCount(){
+uint64_t DeletableBloomFilter::getCount(){
     return count;
 }
 
 /// <summary>
-/// Will test for membership of the data and returns true if it is a member,
-/// false if not. This is a probabilistic test, meaning there is a non-zero
-/// probability of false positives but a zero probability of false negatives.
+/// Returns the scheme used to derive the bucket indices.
 /// </summary>
-/// <param name="data">The data to search for.</param>
-/// <returns>Whether or not the data is maybe contained in the filter.</returns>
-bool DeletableBloomFilter::test(char* data, int len){
+/// <returns>The hash scheme of the filter</returns>
+HashScheme DeletableBloomFilter::getHashScheme(){
+    return indexer.getHashScheme();
+}
+
+/// <summary>
+/// Returns the seed of the hashes, to build another filter with the same
+/// bucket indices.
+/// </summary>
+/// <returns>The seed of the filter</returns>
+uint64_t DeletableBloomFilter::getSeed(){
+    return indexer.getSeed();
+}
+
+/// <summary>
+/// Returns the indexer mapping items onto the buckets and buckets onto the
+/// collision regions of the filter, for introspection.
+/// </summary>
+/// <returns>The indexer of the filter</returns>
+const Indexer& DeletableBloomFilter::getIndexer(){
+    return indexer;
+}
+
+/// <summary>
+/// Returns the number of collision regions marked as collided, whose
+/// buckets can no longer be cleared.
+/// </summary>
+/// <returns>The number of set collision bits</returns>
+uint64_t DeletableBloomFilter::getCollidedRegions(){
+    return collisions.popcount();
+}
+
+template <typename Item>
+inline bool DeletableBloomFilter::testItem(Item& item){
+    uint k = indexer.getK();
     // If any of the K bits are not set, then it's not a member.
-    uint32_t hash;
     for (uint i = 0; i < k; i++){
-        MurmurHash3_x86_32(data, len, i, (void*) &hash);
-        hash %= m;
-        if (buckets[hash] == 0){
+        uint64_t hash = itemIndex(indexer, item, i);
+        if (!buckets.get(hash)){
             return false;
         }
     }
     return true;
 }
 
-/// <summary>
-/// Will add the data to the Bloom filter.
-/// </summary>
-/// <param name="data">The data to add.</param>
-void DeletableBloomFilter::add(char* data, int len){
-    uint32_t hash;
+template <typename Item>
+inline void DeletableBloomFilter::addItem(Item& item){
+    uint k = indexer.getK();
     // Set the K bits.
     for (uint i = 0; i < k; i++){
-        MurmurHash3_x86_32(data, len, i, (void*) &hash);
-        hash %= m;
-        if (buckets[hash] != 0){
+        uint64_t hash = itemIndex(indexer, item, i);
+        if (buckets.testAndSet(hash)){
             // Collision, set corresponding region bit.
-            collisions[hash / regionSize] = 1;
-        }else{
-            buckets[hash] = 1;
+            collisions.set(indexer.region(hash));
         }
     }
     count++;
 }
 
-/// <summary>
-/// Is equivalent to calling Test followed by Add. It returns true if the data is
-/// a member, false if not.
-/// </summary>
-/// <param name="data">The data to test for and add if it doesn't exist.</param>
-/// <returns>Whether or not the data was probably contained in the filter.</returns>
-bool DeletableBloomFilter::testAndAdd(char* data, int len){
+template <typename Item>
+inline bool DeletableBloomFilter::testAndAddItem(Item& item){
     bool member = true;
-    uint32_t hash;
+    uint k = indexer.getK();
     // If any of the K bits are not set, then it's not a member.
     for (uint i = 0; i < k; i++){
-        MurmurHash3_x86_32(data, len, i, (void*) &hash);
-        hash %= m;
-        if (buckets[hash] == 0){
+        uint64_t hash = itemIndex(indexer, item, i);
+        if (!buckets.testAndSet(hash)){
             member = false;
         }else{
             // Collision, set corresponding region bit.
-            collisions[hash / regionSize] = 1;
+            collisions.set(indexer.region(hash));
         }
-        buckets[hash] = 1;
     }
     count++;
     return member;
 }
 
-/// <summary>
-/// Will test for membership of the data and remove it from the filter if it
-/// exists. Returns true if the data was a member, false if not.
-/// </summary>
-/// <param name="data">The data to test for and remove</param>
-/// <returns>Whether or not the data was a member before this call</returns>
-bool DeletableBloomFilter::testAndRemove(char* data, int len){
+template <typename Item>
+inline bool DeletableBloomFilter::testAndRemoveItem(Item& item){
     bool member = true;
-    uint32_t hash;
-    // Set the K bits.
+    uint k = indexer.getK();
     for (uint i = 0; i < k; i++){
-        MurmurHash3_x86_32(data, len, i, (void*) &hash);
-        hash %= m;
-        if (buckets[hash] == 0){
+        uint64_t hash = itemIndex(indexer, item, i);
+        if (!buckets.get(hash)){
             member = false;
         }
     }
 
     if (member){
         for (uint i = 0; i < k; i++){
-            MurmurHash3_x86_32(data, len, i, (void*) &hash);
-            hash %= m;
-            if (collisions[hash / regionSize] == 0){
-                // Clear only bits located in collision-free zones.
-                buckets[hash] = 0;
-            }
+            uint64_t hash = itemIndex(indexer, item, i);
+            // Clear only bits located in collision-free zones.
+            buckets.clearIf(hash, !collisions.get(indexer.region(hash)));
         }
         count--;
     }
@@ -125,11 +135,460 @@ bool DeletableBloomFilter::testAndRemove(char* data, int len){
     return member;
 }
 
+/// <summary>
+/// Will test for membership of the data and returns true if it is a member,
+/// false if not. This is a probabilistic test, meaning there is a non-zero
+/// probability of false positives but a zero probability of false negatives.
+/// </summary>
+/// <param name="data">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool DeletableBloomFilter::test(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testItem(item);
+}
+
+/// <summary>
+/// Will add the data to the Bloom filter.
+/// </summary>
+/// <param name="data">The data to add.</param>
+void DeletableBloomFilter::add(const char* data, int len){
+    RawItem item(indexer, data, len);
+    addItem(item);
+}
+
+/// <summary>
+/// Is equivalent to calling Test followed by Add. It returns true if the data is
+/// a member, false if not.
+/// </summary>
+/// <param name="data">The data to test for and add if it doesn't exist.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool DeletableBloomFilter::testAndAdd(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Will test for membership of the data and remove it from the filter if it
+/// exists. Returns true if the data was a member, false if not.
+/// </summary>
+/// <param name="data">The data to test for and remove</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool DeletableBloomFilter::testAndRemove(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testAndRemoveItem(item);
+}
+
+/// <summary>
+/// Same as Test, for a key hashed beforehand. Throws std::invalid_argument
+/// if the key was hashed with another scheme, or with fewer seeds than the
+/// filter has hash functions.
+/// </summary>
+/// <param name="key">The hashed data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool DeletableBloomFilter::test(const HashedKey& key){
+    indexer.check(key);
+    return testItem(key);
+}
+
+/// <summary>
+/// Same as Add, for a key hashed beforehand. Throws std::invalid_argument as
+/// Test does.
+/// </summary>
+/// <param name="key">The hashed data to add.</param>
+void DeletableBloomFilter::add(const HashedKey& key){
+    indexer.check(key);
+    addItem(key);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key hashed beforehand. Throws
+/// std::invalid_argument as Test does.
+/// </summary>
+/// <param name="key">The hashed data to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool DeletableBloomFilter::testAndAdd(const HashedKey& key){
+    indexer.check(key);
+    return testAndAddItem(key);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key hashed beforehand. Throws
+/// std::invalid_argument as Test does.
+/// </summary>
+/// <param name="key">The hashed data to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool DeletableBloomFilter::testAndRemove(const HashedKey& key){
+    indexer.check(key);
+    return testAndRemoveItem(key);
+}
+
+/// <summary>
+/// Same as Test, for a key split into n fragments, which are hashed in
+/// place with the same result as the contiguous key.
+/// </summary>
+/// <param name="fragments">The fragments of the data to search for.</param>
+/// <param name="n">Number of fragments.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool DeletableBloomFilter::test(const KeyFragment* fragments, size_t n){
+    FragmentItem item(indexer, fragments, n);
+    return testItem(item);
+}
+
+/// <summary>
+/// Same as Add, for a key split into n fragments.
+/// </summary>
+/// <param name="fragments">The fragments of the data to add.</param>
+/// <param name="n">Number of fragments.</param>
+void DeletableBloomFilter::add(const KeyFragment* fragments, size_t n){
+    FragmentItem item(indexer, fragments, n);
+    addItem(item);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key split into n fragments.
+/// </summary>
+/// <param name="fragments">The fragments of the data to test for and add.</param>
+/// <param name="n">Number of fragments.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool DeletableBloomFilter::testAndAdd(const KeyFragment* fragments, size_t n){
+    FragmentItem item(indexer, fragments, n);
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key split into n fragments.
+/// </summary>
+/// <param name="fragments">The fragments of the data to test for and remove.</param>
+/// <param name="n">Number of fragments.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool DeletableBloomFilter::testAndRemove(const KeyFragment* fragments, size_t n){
+    FragmentItem item(indexer, fragments, n);
+    return testAndRemoveItem(item);
+}
+
+/// <summary>
+/// Same as Test, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool DeletableBloomFilter::test(std::string_view key){
+    RawItem item(indexer, key.data(), keyLength(key.size()));
+    return testItem(item);
+}
+
+/// <summary>
+/// Same as Add, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to add.</param>
+void DeletableBloomFilter::add(std::string_view key){
+    RawItem item(indexer, key.data(), keyLength(key.size()));
+    addItem(item);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool DeletableBloomFilter::testAndAdd(std::string_view key){
+    RawItem item(indexer, key.data(), keyLength(key.size()));
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool DeletableBloomFilter::testAndRemove(std::string_view key){
+    RawItem item(indexer, key.data(), keyLength(key.size()));
+    return testAndRemoveItem(item);
+}
+
+/// <summary>
+/// Same as Test, for a 32-bit key, with the same result as its 4
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool DeletableBloomFilter::test(uint32_t key){
+    IntItem<uint32_t> item(indexer, key);
+    return testItem(item);
+}
+
+/// <summary>
+/// Same as Add, for a 32-bit key, with the same result as its 4
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to add.</param>
+void DeletableBloomFilter::add(uint32_t key){
+    IntItem<uint32_t> item(indexer, key);
+    addItem(item);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a 32-bit key, with the same result as its 4
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool DeletableBloomFilter::testAndAdd(uint32_t key){
+    IntItem<uint32_t> item(indexer, key);
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a 32-bit key, with the same result as its 4
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool DeletableBloomFilter::testAndRemove(uint32_t key){
+    IntItem<uint32_t> item(indexer, key);
+    return testAndRemoveItem(item);
+}
+
+/// <summary>
+/// Same as Test, for a 64-bit key, with the same result as its 8
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool DeletableBloomFilter::test(uint64_t key){
+    IntItem<uint64_t> item(indexer, key);
+    return testItem(item);
+}
+
+/// <summary>
+/// Same as Add, for a 64-bit key, with the same result as its 8
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to add.</param>
+void DeletableBloomFilter::add(uint64_t key){
+    IntItem<uint64_t> item(indexer, key);
+    addItem(item);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a 64-bit key, with the same result as its 8
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool DeletableBloomFilter::testAndAdd(uint64_t key){
+    IntItem<uint64_t> item(indexer, key);
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a 64-bit key, with the same result as its 8
+/// little-endian bytes. The key is hashed in registers.
+/// </summary>
+/// <param name="key">The key to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool DeletableBloomFilter::testAndRemove(uint64_t key){
+    IntItem<uint64_t> item(indexer, key);
+    return testAndRemoveItem(item);
+}
+
+size_t DeletableBloomFilter::hashChunk(const Key* keys, size_t n, uint64_t* idx){
+    if (n > BATCH_WINDOW){
+        n = BATCH_WINDOW;
+    }
+    indexer.indicesBatch(keys, n, idx);
+    return n;
+}
+
+/// <summary>
+/// Tests the membership of n items, as n calls to Test would. The keys are
+/// hashed BATCH_WINDOW at a time, ahead of the ones being resolved, and
+/// their bucket words prefetched, so that the memory accesses of consecutive
+/// keys overlap. Under the seeded scheme, keys of the same length are
+/// hashed together with the SIMD kernels of hash-simd.h.
+/// </summary>
+/// <param name="keys">The data to search for.</param>
+/// <param name="n">Number of keys.</param>
+/// <param name="results">Set to 1 for the keys that are maybe contained in
+/// the filter, 0 otherwise.</param>
+void DeletableBloomFilter::testBatch(const Key* keys, size_t n, uint8_t* results){
+    uint k = indexer.getK();
+    // Indices of the keys in flight, 2 * BATCH_WINDOW slots of k indices each.
+    // The keys are hashed BATCH_WINDOW at a time into one half of the window,
+    // while the other half is resolved.
+    std::vector<uint64_t> window(2 * BATCH_WINDOW * k);
+    for (size_t j = 0; j < n + BATCH_WINDOW; j++){
+        if (j < n && j % BATCH_WINDOW == 0){
+            uint64_t* idx = &window[(j % (2 * BATCH_WINDOW)) * k];
+            size_t hashed = hashChunk(keys + j, n - j, idx) * k;
+            for (size_t i = 0; i < hashed; i++){
+                buckets.prefetch(idx[i]);
+            }
+        }
+        if (j >= BATCH_WINDOW){
+            // The slot of the key hashed BATCH_WINDOW iterations ago.
+            uint64_t* idx = &window[((j - BATCH_WINDOW) % (2 * BATCH_WINDOW)) * k];
+            uint8_t member = 1;
+            for (uint i = 0; i < k; i++){
+                member &= buckets.get(idx[i]);
+            }
+            results[j - BATCH_WINDOW] = member;
+        }
+    }
+}
+
+/// <summary>
+/// Adds n items, with the same result as n calls to Add in order. The bucket
+/// words are prefetched as in TestBatch.
+/// </summary>
+/// <param name="keys">The data to add.</param>
+/// <param name="n">Number of keys.</param>
+void DeletableBloomFilter::addBatch(const Key* keys, size_t n){
+    uint k = indexer.getK();
+    std::vector<uint64_t> window(2 * BATCH_WINDOW * k);
+    for (size_t j = 0; j < n + BATCH_WINDOW; j++){
+        if (j < n && j % BATCH_WINDOW == 0){
+            uint64_t* idx = &window[(j % (2 * BATCH_WINDOW)) * k];
+            size_t hashed = hashChunk(keys + j, n - j, idx) * k;
+            for (size_t i = 0; i < hashed; i++){
+                buckets.prefetchWrite(idx[i]);
+            }
+        }
+        if (j >= BATCH_WINDOW){
+            uint64_t* idx = &window[((j - BATCH_WINDOW) % (2 * BATCH_WINDOW)) * k];
+            for (uint i = 0; i < k; i++){
+                if (buckets.testAndSet(idx[i])){
+                    // Collision, set corresponding region bit.
+                    collisions.set(indexer.region(idx[i]));
+                }
+            }
+            count++;
+        }
+    }
+}
+
+/// <summary>
+/// Adds n items using several threads, with the same buckets, collision
+/// regions and count as n calls to Add. The keys are processed in rounds of
+/// BUILD_CHUNK keys per thread: each thread hashes its share of the round
+/// and partitions the bucket indices by range, then each thread sets the
+/// buckets of its own ranges. A range covers whole words of both the
+/// buckets and the collision regions, so no atomic operation is needed.
+/// There are at most about r / 64 ranges, which bounds the parallelism of
+/// the second phase for filters with few collision regions.
+/// </summary>
+/// <param name="keys">The data to add.</param>
+/// <param name="n">Number of keys.</param>
+/// <param name="threads">Number of threads, 0 for one per hardware
+/// thread.</param>
+void DeletableBloomFilter::buildFrom(const Key* keys, size_t n, uint threads){
+    if (!threads){
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads <= 1 || n < BUILD_CHUNK){
+        addBatch(keys, n);
+        return;
+    }
+    uint k = indexer.getK();
+
+    // A range is a power of two number of collision words. Its first bucket is
+    // a multiple of 64 * regionSize, so it starts on a bucket word as well.
+    uint64_t collisionWords = (collisions.getSize() + 63) / 64;
+    uint64_t span = nextPowerOfTwo((collisionWords + threads * BUILD_PARTITIONS - 1) /
+                                   (threads * BUILD_PARTITIONS));
+    uint shift = 6 + __builtin_ctzll(span);
+    size_t partitions = (collisionWords + span - 1) / span;
+
+    // parts[t * partitions + p] holds the indices of range p hashed by thread t.
+    std::vector<std::vector<uint64_t>> parts(threads * partitions);
+    std::vector<std::vector<uint64_t>> idx(threads, std::vector<uint64_t>(BUILD_CHUNK * k));
+    auto run = [threads](auto op){
+        std::vector<std::thread> workers;
+        for (uint t = 1; t < threads; t++){
+            workers.emplace_back(op, t);
+        }
+        op(0);
+        for (std::thread& w : workers){
+            w.join();
+        }
+    };
+
+    for (size_t start = 0; start < n; start += (size_t) threads * BUILD_CHUNK){
+        size_t round = std::min(n - start, (size_t) threads * BUILD_CHUNK);
+        run([&, start, round](uint t){
+            size_t from = start + round * t / threads;
+            size_t hashed = (start + round * (t + 1) / threads - from) * k;
+            indexer.indicesBatch(keys + from, hashed / k, idx[t].data());
+            std::vector<uint64_t>* own = &parts[t * partitions];
+            for (size_t i = 0; i < hashed; i++){
+                own[indexer.region(idx[t][i]) >> shift].push_back(idx[t][i]);
+            }
+        });
+        run([&](uint t){
+            for (size_t p = t; p < partitions; p += threads){
+                for (uint s = 0; s < threads; s++){
+                    // A bucket set before, or hit more than once, collides as
+                    // it would whatever the order of the Adds.
+                    for (uint64_t hash : parts[s * partitions + p]){
+                        if (buckets.testAndSet(hash)){
+                            collisions.set(indexer.region(hash));
+                        }
+                    }
+                    parts[s * partitions + p].clear();
+                }
+            }
+        });
+    }
+    count += n;
+}
+
+/// <summary>
+/// Tests and removes n items, with the same result as n calls to
+/// TestAndRemove in order. The bucket and collision words are prefetched as
+/// in TestBatch.
+/// </summary>
+/// <param name="keys">The data to test for and remove.</param>
+/// <param name="n">Number of keys.</param>
+/// <param name="results">Set to 1 for the keys that were members before the
+/// call, 0 otherwise.</param>
+void DeletableBloomFilter::removeBatch(const Key* keys, size_t n, uint8_t* results){
+    uint k = indexer.getK();
+    std::vector<uint64_t> window(2 * BATCH_WINDOW * k);
+    for (size_t j = 0; j < n + BATCH_WINDOW; j++){
+        if (j < n && j % BATCH_WINDOW == 0){
+            uint64_t* idx = &window[(j % (2 * BATCH_WINDOW)) * k];
+            size_t hashed = hashChunk(keys + j, n - j, idx) * k;
+            for (size_t i = 0; i < hashed; i++){
+                buckets.prefetchWrite(idx[i]);
+                collisions.prefetch(indexer.region(idx[i]));
+            }
+        }
+        if (j >= BATCH_WINDOW){
+            uint64_t* idx = &window[((j - BATCH_WINDOW) % (2 * BATCH_WINDOW)) * k];
+            uint8_t member = 1;
+            for (uint i = 0; i < k; i++){
+                member &= buckets.get(idx[i]);
+            }
+            if (member){
+                for (uint i = 0; i < k; i++){
+                    // Clear only bits located in collision-free zones.
+                    buckets.clearIf(idx[i], !collisions.get(indexer.region(idx[i])));
+                }
+                count--;
+            }
+            results[j - BATCH_WINDOW] = member;
+        }
+    }
+}
+
 /// <summary>
 /// Restores the Bloom filter to its original state. 
 /// </summary>
 void DeletableBloomFilter::reset(){
-    buckets.assign(buckets.size(), 0);
-    collisions.assign(collisions.size(), 0);
+    buckets.reset();
+    collisions.reset();
     count = 0;
 }
@@ -6,32 +6,85 @@
 ///
 /// The code has been ported from https://github.com/mattlorimor/ProbabilisticDataStructures/blob/master/ProbabilisticDataStructures/DeletableBloomFilter.cs
 
-#include "hash.h"
+#ifndef _DEL_BF_H_
+#define _DEL_BF_H_
+
+#include "bitset.h"
+#include "indexer.h"
 
 #include <cmath>
-#include <vector>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
 
 #define FILL_RATIO (0.5)
 
+/// Number of keys the batch operations hash ahead of the one being resolved.
+#define BATCH_WINDOW (16)
+
+/// Number of keys each thread of BuildFrom hashes per round.
+#define BUILD_CHUNK (1 << 16)
+
+/// Number of bucket ranges per thread BuildFrom splits the filter into.
+#define BUILD_PARTITIONS (4)
+
 class DeletableBloomFilter{
+public:
+    /// An item passed to the batch operations.
+    struct Key{
+        const char* data; /// Item data
+        int len; /// Length of the data
+    };
+
 private:
-    std::vector<bool> buckets; /// Filter data
-    std::vector<bool> collisions; /// Filter collision data
-    uint m; /// Filter size
-    uint regionSize; /// Number of bits in a region
-    uint k; /// Number of hash functions
-    uint count; /// Number of items in the filter
-
-    static uint optimalM(uint n, double fpRate){
-        return std::ceil((double) n / ((std::log(FILL_RATIO) *
-                std::log(1 - FILL_RATIO)) / std::abs(std::log(fpRate))));
+    Bitset buckets; /// Filter data
+    Bitset collisions; /// Filter collision data
+    Indexer indexer; /// Maps items onto buckets and buckets onto regions
+    uint64_t count; /// Number of items in the filter
+    std::shared_ptr<void> mapping; /// Memory-mapped snapshot backing the bitsets, if any
+
+    DeletableBloomFilter(){}
+
+    /// Opens a snapshot, either copying its words or mapping them in place.
+    static DeletableBloomFilter open(const char* path, bool mapped, bool verify);
+
+    /// Stores the indices of the next at most BATCH_WINDOW keys of a batch in
+    /// idx and returns the number of keys hashed.
+    size_t hashChunk(const Key* keys, size_t n, uint64_t* idx);
+
+    /// Operations on an item, a RawItem, a FragmentItem, an IntItem or a HashedKey.
+    template <typename Item> bool testItem(Item& item);
+    template <typename Item> void addItem(Item& item);
+    template <typename Item> bool testAndAddItem(Item& item);
+    template <typename Item> bool testAndRemoveItem(Item& item);
+
+public:
+    /// <summary>
+    /// Returns the number of bits needed to store n items with the specified
+    /// false-positive rate. Throws std::invalid_argument if the rate is not in
+    /// (0, 1) and std::overflow_error if the result does not fit in 64 bits.
+    /// </summary>
+    static uint64_t optimalM(uint64_t n, double fpRate){
+        if (!(fpRate > 0 && fpRate < 1)){
+            throw std::invalid_argument("fpRate must be in (0, 1)");
+        }
+        double m = std::ceil((double) n / ((std::log(FILL_RATIO) *
+                   std::log(1 - FILL_RATIO)) / std::abs(std::log(fpRate))));
+        // 2^64 is the first double that does not fit.
+        if (!(m < 18446744073709551616.0)){
+            throw std::overflow_error("Filter size does not fit in 64 bits");
+        }
+        return m;
     }
 
+    /// <summary>
+    /// Returns the number of hash functions needed to achieve the specified
+    /// false-positive rate.
+    /// </summary>
     static uint optimalK(double fpRate){
         return std::ceil(std::log2(1 / fpRate));
     }
 
-public:
     /// <summary>
     /// NewDeletableBloomFilter creates a new DeletableBloomFilter optimized to store
     /// n items with a specified target false-positive rate. The r value determines
@@ -41,13 +94,51 @@ public:
     /// <param name="n">Number of items</param>
     /// <param name="r">Number of bits to use to store collision information</param>
     /// <param name="fpRate">Desired false positive rate</param>
-    DeletableBloomFilter(uint n, uint r, double fpRate);
+    /// <param name="hashScheme">Scheme used to derive the bucket indices</param>
+    /// <param name="powerOfTwo">Whether to round the number of buckets up to a
+    /// power of two, so that bucket indices are reduced with a mask. Regions
+    /// are then indexed with a shift as well if r is a power of two.</param>
+    /// <param name="seed">Seed of the hashes, 0 for the original layout. A
+    /// secret seed, such as randomSeed(), with HASH_SCHEME_SIPHASH keeps
+    /// attackers from crafting colliding keys. Filters that exchange
+    /// HashedKeys, or a filter rebuilt from the same items, must use the same
+    /// seed, see getSeed().</param>
+    DeletableBloomFilter(uint64_t n, uint64_t r, double fpRate,
+                         HashScheme hashScheme = HASH_SCHEME_SEEDED,
+                         bool powerOfTwo = false, uint64_t seed = 0);
 
     /// <summary>
     /// Returns the number of items added to the filter.
     /// </summary>
     /// <returns>The number of items added to the filter</returns>
-    uint getCount();
+    uint64_t getCount();
+
+    /// <summary>
+    /// Returns the scheme used to derive the bucket indices.
+    /// </summary>
+    /// <returns>The hash scheme of the filter</returns>
+    HashScheme getHashScheme();
+
+    /// <summary>
+    /// Returns the seed of the hashes, to build another filter with the same
+    /// bucket indices.
+    /// </summary>
+    /// <returns>The seed of the filter</returns>
+    uint64_t getSeed();
+
+    /// <summary>
+    /// Returns the indexer mapping items onto the buckets and buckets onto the
+    /// collision regions of the filter, for introspection.
+    /// </summary>
+    /// <returns>The indexer of the filter</returns>
+    const Indexer& getIndexer();
+
+    /// <summary>
+    /// Returns the number of collision regions marked as collided, whose
+    /// buckets can no longer be cleared.
+    /// </summary>
+    /// <returns>The number of set collision bits</returns>
+    uint64_t getCollidedRegions();
 
     /// <summary>
     /// Will test for membership of the data and returns true if it is a member,
@@ -56,13 +147,13 @@ public:
     /// </summary>
     /// <param name="data">The data to search for.</param>
     /// <returns>Whether or not the data is maybe contained in the filter.</returns>
-    bool test(char* data, int len);
+    bool test(const char* data, int len);
 
     /// <summary>
     /// Will add the data to the Bloom filter.
     /// </summary>
     /// <param name="data">The data to add.</param>
-    void add(char* data, int len);
+    void add(const char* data, int len);
 
     /// <summary>
     /// Is equivalent to calling Test followed by Add. It returns true if the data is
@@ -70,7 +161,7 @@ public:
     /// </summary>
     /// <param name="data">The data to test for and add if it doesn't exist.</param>
     /// <returns>Whether or not the data was probably contained in the filter.</returns>
-    bool testAndAdd(char* data, int len);
+    bool testAndAdd(const char* data, int len);
 
     /// <summary>
     /// Will test for membership of the data and remove it from the filter if it
@@ -78,10 +169,266 @@ public:
     /// </summary>
     /// <param name="data">The data to test for and remove</param>
     /// <returns>Whether or not the data was a member before this call</returns>
-    bool testAndRemove(char* data, int len);
+    bool testAndRemove(const char* data, int len);
+
+    /// <summary>
+    /// Same as Test, for a key hashed beforehand. Throws std::invalid_argument
+    /// if the key was hashed with another scheme, or with fewer seeds than the
+    /// filter has hash functions.
+    /// </summary>
+    /// <param name="key">The hashed data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const HashedKey& key);
+
+    /// <summary>
+    /// Same as Add, for a key hashed beforehand. Throws std::invalid_argument as
+    /// Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to add.</param>
+    void add(const HashedKey& key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key hashed beforehand. Throws
+    /// std::invalid_argument as Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const HashedKey& key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key hashed beforehand. Throws
+    /// std::invalid_argument as Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const HashedKey& key);
+
+    /// <summary>
+    /// Same as Test, for a key split into n fragments, which are hashed in
+    /// place with the same result as the contiguous key.
+    /// </summary>
+    /// <param name="fragments">The fragments of the data to search for.</param>
+    /// <param name="n">Number of fragments.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const KeyFragment* fragments, size_t n);
+
+    /// <summary>
+    /// Same as Add, for a key split into n fragments.
+    /// </summary>
+    /// <param name="fragments">The fragments of the data to add.</param>
+    /// <param name="n">Number of fragments.</param>
+    void add(const KeyFragment* fragments, size_t n);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key split into n fragments.
+    /// </summary>
+    /// <param name="fragments">The fragments of the data to test for and add.</param>
+    /// <param name="n">Number of fragments.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const KeyFragment* fragments, size_t n);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key split into n fragments.
+    /// </summary>
+    /// <param name="fragments">The fragments of the data to test for and remove.</param>
+    /// <param name="n">Number of fragments.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const KeyFragment* fragments, size_t n);
+
+    /// <summary>
+    /// Same as Test, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(std::string_view key);
+
+    /// <summary>
+    /// Same as Add, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to add.</param>
+    void add(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(std::string_view key);
+
+    /// <summary>
+    /// Same as Test, for a 32-bit key, with the same result as its 4
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(uint32_t key);
+
+    /// <summary>
+    /// Same as Add, for a 32-bit key, with the same result as its 4
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to add.</param>
+    void add(uint32_t key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a 32-bit key, with the same result as its 4
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(uint32_t key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a 32-bit key, with the same result as its 4
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(uint32_t key);
+
+    /// <summary>
+    /// Same as Test, for a 64-bit key, with the same result as its 8
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(uint64_t key);
+
+    /// <summary>
+    /// Same as Add, for a 64-bit key, with the same result as its 8
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to add.</param>
+    void add(uint64_t key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a 64-bit key, with the same result as its 8
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(uint64_t key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a 64-bit key, with the same result as its 8
+    /// little-endian bytes. The key is hashed in registers.
+    /// </summary>
+    /// <param name="key">The key to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(uint64_t key);
+
+#ifdef __cpp_lib_span
+    /// <summary>
+    /// Same as the string_view overloads, for a key given as bytes.
+    /// </summary>
+    bool test(std::span<const std::byte> key){
+        return test(std::string_view((const char*) key.data(), key.size()));
+    }
+    void add(std::span<const std::byte> key){
+        add(std::string_view((const char*) key.data(), key.size()));
+    }
+    bool testAndAdd(std::span<const std::byte> key){
+        return testAndAdd(std::string_view((const char*) key.data(), key.size()));
+    }
+    bool testAndRemove(std::span<const std::byte> key){
+        return testAndRemove(std::string_view((const char*) key.data(), key.size()));
+    }
+#endif
+
+    /// <summary>
+    /// Tests the membership of n items, as n calls to Test would. The keys are
+    /// hashed BATCH_WINDOW at a time, ahead of the ones being resolved, and
+    /// their bucket words prefetched, so that the memory accesses of consecutive
+    /// keys overlap. Under the seeded scheme, keys of the same length are
+    /// hashed together with the SIMD kernels of hash-simd.h.
+    /// </summary>
+    /// <param name="keys">The data to search for.</param>
+    /// <param name="n">Number of keys.</param>
+    /// <param name="results">Set to 1 for the keys that are maybe contained in
+    /// the filter, 0 otherwise.</param>
+    void testBatch(const Key* keys, size_t n, uint8_t* results);
+
+    /// <summary>
+    /// Adds n items, with the same result as n calls to Add in order. The bucket
+    /// words are prefetched as in TestBatch.
+    /// </summary>
+    /// <param name="keys">The data to add.</param>
+    /// <param name="n">Number of keys.</param>
+    void addBatch(const Key* keys, size_t n);
+
+    /// <summary>
+    /// Tests and removes n items, with the same result as n calls to
+    /// TestAndRemove in order. The bucket and collision words are prefetched as
+    /// in TestBatch.
+    /// </summary>
+    /// <param name="keys">The data to test for and remove.</param>
+    /// <param name="n">Number of keys.</param>
+    /// <param name="results">Set to 1 for the keys that were members before the
+    /// call, 0 otherwise.</param>
+    void removeBatch(const Key* keys, size_t n, uint8_t* results);
+
+    /// <summary>
+    /// Adds n items using several threads, with the same buckets, collision
+    /// regions and count as n calls to Add. The keys are processed in rounds of
+    /// BUILD_CHUNK keys per thread: each thread hashes its share of the round
+    /// and partitions the bucket indices by range, then each thread sets the
+    /// buckets of its own ranges. A range covers whole words of both the
+    /// buckets and the collision regions, so no atomic operation is needed.
+    /// There are at most about r / 64 ranges, which bounds the parallelism of
+    /// the second phase for filters with few collision regions.
+    /// </summary>
+    /// <param name="keys">The data to add.</param>
+    /// <param name="n">Number of keys.</param>
+    /// <param name="threads">Number of threads, 0 for one per hardware
+    /// thread.</param>
+    void buildFrom(const Key* keys, size_t n, uint threads = 0);
+
+    /// <summary>
+    /// Saves a snapshot of the filter to a file, in the format described in
+    /// snapshot.h. Throws std::runtime_error if the file cannot be written.
+    /// </summary>
+    /// <param name="path">Path of the snapshot file</param>
+    void save(const char* path);
+
+    /// <summary>
+    /// Loads a filter from a snapshot saved with Save, copying its data.
+    /// Throws std::runtime_error if the file cannot be read, is not a valid
+    /// snapshot or does not match its checksum.
+    /// </summary>
+    /// <param name="path">Path of the snapshot file</param>
+    /// <returns>The filter stored in the snapshot</returns>
+    static DeletableBloomFilter load(const char* path);
+
+    /// <summary>
+    /// Opens a filter from a snapshot saved with Save without copying its data:
+    /// the buckets and the collision regions are served straight from the
+    /// memory-mapped file, and pages are only read from disk when first
+    /// accessed. The filter can still be modified, but the changes are private
+    /// to the process and are never written back to the file. Throws
+    /// std::runtime_error if the file cannot be mapped or is not a valid
+    /// snapshot.
+    /// </summary>
+    /// <param name="path">Path of the snapshot file</param>
+    /// <param name="verify">Whether to verify the checksum, which reads the
+    /// whole file</param>
+    /// <returns>The filter stored in the snapshot</returns>
+    static DeletableBloomFilter openMapped(const char* path, bool verify = false);
 
     /// <summary>
     /// Restores the Bloom filter to its original state. 
     /// </summary>
     void reset();
 };
+
+#endif // _DEL_BF_H_
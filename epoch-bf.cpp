@@ -0,0 +1,377 @@
+/// EpochDeletableBloomFilter is a DeletableBloomFilter with a single writer
+/// and wait-free readers, see epoch-bf.h for the versions and their
+/// reclamation.
+
+#include "epoch-bf.h"
+
+#include <stdexcept>
+
+#define EPOCH_PAGE_BITS (EPOCH_PAGE_WORDS * 64)
+
+EpochDeletableBloomFilter::EpochDeletableBloomFilter(uint64_t n, uint64_t r, double fpRate,
+                                                     HashScheme hashScheme, bool powerOfTwo,
+                                                     uint64_t seed) :
+        epoch(1), collisions(r), count(0){
+    uint64_t optM = DeletableBloomFilter::optimalM(n, fpRate);
+    uint64_t m = powerOfTwo ? nextPowerOfTwo(optM - r) : optM - r;
+    indexer = Indexer(m, r, DeletableBloomFilter::optimalK(fpRate), hashScheme, seed);
+
+    numPages = (m + EPOCH_PAGE_BITS - 1) / EPOCH_PAGE_BITS;
+    working.resize(numPages);
+    dirty.resize(numPages, false);
+    Version* version = new Version();
+    version->pages.resize(numPages);
+    for (size_t p = 0; p < numPages; p++){
+        working[p] = (uint64_t*) allocateWords(EPOCH_PAGE_BITS, sizeof(uint64_t));
+        memset(working[p], 0, EPOCH_PAGE_WORDS * sizeof(uint64_t));
+        version->pages[p] = working[p];
+    }
+    current.store(version);
+    for (size_t i = 0; i < EPOCH_READER_SLOTS; i++){
+        slots[i].epoch.store(0);
+        slots[i].used.store(false);
+    }
+}
+
+/// <summary>
+/// Frees all the versions. No Reader must be alive.
+/// </summary>
+EpochDeletableBloomFilter::~EpochDeletableBloomFilter(){
+    for (Retired& r : retired){
+        for (uint64_t* page : r.pages){
+            free(page);
+        }
+        delete r.version;
+    }
+    // The working version shares the pages that are not dirty with the
+    // published one.
+    Version* version = current.load();
+    for (size_t p = 0; p < numPages; p++){
+        if (dirty[p]){
+            free((void*) version->pages[p]);
+        }
+        free(working[p]);
+    }
+    delete version;
+}
+
+inline uint64_t* EpochDeletableBloomFilter::writableWord(uint64_t bucket){
+    size_t p = bucket / EPOCH_PAGE_BITS;
+    if (!dirty[p]){
+        uint64_t* copy = (uint64_t*) allocateWords(EPOCH_PAGE_BITS, sizeof(uint64_t));
+        memcpy(copy, working[p], EPOCH_PAGE_WORDS * sizeof(uint64_t));
+        working[p] = copy;
+        dirty[p] = true;
+        dirtyPages.push_back(p);
+    }
+    return working[p] + (bucket / 64) % EPOCH_PAGE_WORDS;
+}
+
+inline bool EpochDeletableBloomFilter::getBucket(uint64_t bucket){
+    return (working[bucket / EPOCH_PAGE_BITS][(bucket / 64) % EPOCH_PAGE_WORDS] >> (bucket % 64)) & 1;
+}
+
+inline bool EpochDeletableBloomFilter::testItem(RawItem& item){
+    uint k = indexer.getK();
+    // If any of the K bits are not set, then it's not a member.
+    for (uint i = 0; i < k; i++){
+        if (!getBucket(itemIndex(indexer, item, i))){
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool EpochDeletableBloomFilter::testAndAddItem(RawItem& item){
+    bool member = true;
+    uint k = indexer.getK();
+    for (uint i = 0; i < k; i++){
+        uint64_t hash = itemIndex(indexer, item, i);
+        uint64_t bit = (uint64_t) 1 << (hash % 64);
+        if (!getBucket(hash)){
+            member = false;
+            *writableWord(hash) |= bit;
+        }else{
+            // Collision, set corresponding region bit.
+            collisions.set(indexer.region(hash));
+        }
+    }
+    count++;
+    return member;
+}
+
+inline bool EpochDeletableBloomFilter::testAndRemoveItem(RawItem& item){
+    if (!testItem(item)){
+        return false;
+    }
+    uint k = indexer.getK();
+    for (uint i = 0; i < k; i++){
+        uint64_t hash = itemIndex(indexer, item, i);
+        // Clear only bits located in collision-free zones, copying their page
+        // only if a bit is actually cleared.
+        if (!collisions.get(indexer.region(hash)) && getBucket(hash)){
+            *writableWord(hash) &= ~((uint64_t) 1 << (hash % 64));
+        }
+    }
+    count--;
+    return true;
+}
+
+/// <summary>
+/// Returns the number of items added to the filter, including the
+/// unpublished updates. Writer only.
+/// </summary>
+/// <returns>The number of items added to the filter</returns>
+uint64_t EpochDeletableBloomFilter::getCount(){
+    return count;
+}
+
+/// <summary>
+/// Returns the indexer mapping items onto the buckets and buckets onto the
+/// collision regions of the filter.
+/// </summary>
+/// <returns>The indexer of the filter</returns>
+const Indexer& EpochDeletableBloomFilter::getIndexer(){
+    return indexer;
+}
+
+/// <summary>
+/// Will test for membership of the data in the working version of the
+/// filter, including the unpublished updates. Writer only, readers go
+/// through a Reader.
+/// </summary>
+/// <param name="data">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool EpochDeletableBloomFilter::test(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testItem(item);
+}
+
+/// <summary>
+/// Will add the data to the working version of the filter. Writer only,
+/// the readers see it after the next Publish.
+/// </summary>
+/// <param name="data">The data to add.</param>
+void EpochDeletableBloomFilter::add(const char* data, int len){
+    RawItem item(indexer, data, len);
+    testAndAddItem(item);
+}
+
+/// <summary>
+/// Is equivalent to calling Test followed by Add. It returns true if the data is
+/// a member, false if not. Writer only.
+/// </summary>
+/// <param name="data">The data to test for and add if it doesn't exist.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool EpochDeletableBloomFilter::testAndAdd(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Will test for membership of the data and remove it from the working
+/// version of the filter if it exists. Returns true if the data was a
+/// member, false if not. Writer only.
+/// </summary>
+/// <param name="data">The data to test for and remove</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool EpochDeletableBloomFilter::testAndRemove(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testAndRemoveItem(item);
+}
+
+/// <summary>
+/// Same as Test, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool EpochDeletableBloomFilter::test(std::string_view key){
+    return test(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as Add, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to add.</param>
+void EpochDeletableBloomFilter::add(std::string_view key){
+    add(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool EpochDeletableBloomFilter::testAndAdd(std::string_view key){
+    return testAndAdd(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool EpochDeletableBloomFilter::testAndRemove(std::string_view key){
+    return testAndRemove(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Publishes the working version to the readers, retires the previous one
+/// and frees the retired versions no reader can still use. Writer only.
+/// The pages written since the last publication become immutable, and
+/// are copied again by the next write to them.
+/// </summary>
+void EpochDeletableBloomFilter::publish(){
+    if (!dirtyPages.empty()){
+        Version* version = new Version();
+        version->pages.assign(working.begin(), working.end());
+        Version* old = current.exchange(version);
+
+        Retired r;
+        r.epoch = epoch.load();
+        r.version = old;
+        for (size_t p : dirtyPages){
+            r.pages.push_back((uint64_t*) old->pages[p]);
+            dirty[p] = false;
+        }
+        dirtyPages.clear();
+        retired.push_back(std::move(r));
+
+        // Readers entering from now on announce a later epoch, and load the
+        // new version.
+        epoch.fetch_add(1);
+    }
+    reclaim();
+}
+
+/// <summary>
+/// Frees the retired versions no reader can still use, and returns the
+/// number of versions still waiting. Publish calls it, a writer with no
+/// more updates to publish can call it to release the memory of versions
+/// read by stalled readers. Writer only.
+/// </summary>
+/// <returns>The number of retired versions not freed yet</returns>
+size_t EpochDeletableBloomFilter::reclaim(){
+    // A reader that announced epoch e may use any version retired at e or
+    // later.
+    uint64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < EPOCH_READER_SLOTS; i++){
+        uint64_t e = slots[i].epoch.load();
+        if (e && e < oldest){
+            oldest = e;
+        }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < retired.size(); i++){
+        if (retired[i].epoch < oldest){
+            for (uint64_t* page : retired[i].pages){
+                free(page);
+            }
+            delete retired[i].version;
+        }else{
+            retired[kept++] = std::move(retired[i]);
+        }
+    }
+    retired.resize(kept);
+    return kept;
+}
+
+/// <summary>
+/// Restores the working version of the filter to its original state.
+/// Writer only, the readers see it after the next Publish.
+/// </summary>
+void EpochDeletableBloomFilter::reset(){
+    for (size_t p = 0; p < numPages; p++){
+        // A clean page is shared with the published version: it is replaced
+        // by a new page, zeroed without copying the old one first.
+        if (!dirty[p]){
+            working[p] = (uint64_t*) allocateWords(EPOCH_PAGE_BITS, sizeof(uint64_t));
+            dirty[p] = true;
+            dirtyPages.push_back(p);
+        }
+        memset(working[p], 0, EPOCH_PAGE_WORDS * sizeof(uint64_t));
+    }
+    collisions.reset();
+    count = 0;
+}
+
+/// <summary>
+/// Claims a reader slot of the filter. Throws std::runtime_error if
+/// EPOCH_READER_SLOTS readers are already alive.
+/// </summary>
+/// <param name="filter">The filter to read</param>
+EpochDeletableBloomFilter::Reader::Reader(EpochDeletableBloomFilter& filter) : filter(&filter), slot(NULL){
+    for (size_t i = 0; i < EPOCH_READER_SLOTS; i++){
+        if (!filter.slots[i].used.load(std::memory_order_relaxed) && !filter.slots[i].used.exchange(true)){
+            slot = &filter.slots[i];
+            return;
+        }
+    }
+    throw std::runtime_error("No reader slot left");
+}
+
+EpochDeletableBloomFilter::Reader::~Reader(){
+    slot->used.store(false, std::memory_order_release);
+}
+
+template <typename Item>
+inline bool EpochDeletableBloomFilter::Reader::testItem(Item& item){
+    // The load of the epoch, the announcement and the load of the version are
+    // sequentially consistent with the exchange, the increment of the epoch
+    // and the scan of Publish. If this lookup loads the version that Publish
+    // retires at epoch X, it does so before the exchange, so it read the epoch
+    // before the increment, at most X, and announced it before the scan. The
+    // scan then keeps the version.
+    slot->epoch.store(filter->epoch.load());
+    const Version* version = filter->current.load();
+    const Indexer& indexer = filter->indexer;
+    bool member = true;
+    uint k = indexer.getK();
+    for (uint i = 0; i < k; i++){
+        uint64_t hash = itemIndex(indexer, item, i);
+        const uint64_t* page = version->pages[hash / EPOCH_PAGE_BITS];
+        if (!((page[(hash / 64) % EPOCH_PAGE_WORDS] >> (hash % 64)) & 1)){
+            member = false;
+            break;
+        }
+    }
+    slot->epoch.store(0, std::memory_order_release);
+    return member;
+}
+
+/// <summary>
+/// Will test for membership of the data in the published version of
+/// the filter, without waiting for the writer.
+/// </summary>
+/// <param name="data">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool EpochDeletableBloomFilter::Reader::test(const char* data, int len){
+    RawItem item(filter->indexer, data, len);
+    return testItem(item);
+}
+
+/// <summary>
+/// Same as Test, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool EpochDeletableBloomFilter::Reader::test(std::string_view key){
+    return test(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as Test, for a key hashed beforehand. Throws
+/// std::invalid_argument if the key cannot be used with the filter,
+/// see DeletableBloomFilter.
+/// </summary>
+/// <param name="key">The hashed data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool EpochDeletableBloomFilter::Reader::test(const HashedKey& key){
+    filter->indexer.check(key);
+    return testItem(key);
+}
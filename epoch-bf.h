@@ -0,0 +1,266 @@
+/// EpochDeletableBloomFilter is a DeletableBloomFilter for read-mostly
+/// workloads with a single writer thread, whose readers probe an immutable
+/// published version of the buckets, without any atomic operation on the
+/// bucket words and without ever waiting for the writer.
+///
+/// The buckets are split into pages of EPOCH_PAGE_WORDS words. A version is a
+/// table of pointers to pages. The writer updates its own working table: the
+/// first write to a published page since the last publication copies it, and
+/// the copy is written in place from then on. Publish() then swaps in a new
+/// version made of the working table, which readers see from their next
+/// lookup on, and retires the previous version and the pages it alone
+/// referenced.
+///
+/// Retired versions are reclaimed by epochs: the writer advances the global
+/// epoch at each publication, and each reader announces the epoch it entered
+/// in its own slot for the duration of a lookup. A version retired at epoch E
+/// is freed once no reader is inside a lookup entered at epoch E or before, so
+/// a reader never sees a version freed, and the writer never waits for the
+/// readers: a stalled reader only delays the reclamation.
+///
+/// Readers go through a Reader handle, which holds a slot, one per thread.
+/// The collision regions and the count are private to the writer, whose own
+/// operations see its unpublished updates.
+
+#ifndef _EPOCH_BF_H_
+#define _EPOCH_BF_H_
+
+#include "bitset.h"
+#include "del-bf.h"
+#include "indexer.h"
+
+#include <atomic>
+#include <vector>
+
+/// Number of 64-bit words of a page of buckets, 4 KiB.
+#define EPOCH_PAGE_WORDS (512)
+
+/// Largest number of Reader handles alive at the same time.
+#define EPOCH_READER_SLOTS (128)
+
+class EpochDeletableBloomFilter{
+private:
+    /// A published version of the buckets, which is never written.
+    struct Version{
+        std::vector<const uint64_t*> pages; /// Pages of buckets
+    };
+
+    /// A version replaced by a publication, freed with the pages only it
+    /// referenced once no reader can still use it.
+    struct Retired{
+        uint64_t epoch; /// Epoch the version was retired at
+        Version* version; /// The version
+        std::vector<uint64_t*> pages; /// Pages replaced by the next version
+    };
+
+    /// A reader slot, alone in its cache line.
+    struct alignas(BITSET_ALIGNMENT) ReaderSlot{
+        std::atomic<uint64_t> epoch; /// Epoch of the lookup in progress, 0 if none
+        std::atomic<bool> used; /// Whether a Reader holds the slot
+    };
+
+    Indexer indexer; /// Maps items onto buckets and buckets onto regions
+    size_t numPages; /// Number of pages of buckets
+    std::atomic<Version*> current; /// Published version
+    std::atomic<uint64_t> epoch; /// Global epoch, starting at 1
+    ReaderSlot slots[EPOCH_READER_SLOTS]; /// Epochs announced by the readers
+
+    // State of the writer.
+    std::vector<uint64_t*> working; /// Pages of the working version
+    std::vector<bool> dirty; /// Whether a page of the working version is a private copy
+    std::vector<size_t> dirtyPages; /// Pages of the working version that are private copies
+    Bitset collisions; /// Filter collision data
+    uint64_t count; /// Number of items in the filter
+    std::vector<Retired> retired; /// Versions waiting to be freed
+
+    /// Returns the word of the working version holding a bucket, copying its
+    /// page first if it is still published.
+    uint64_t* writableWord(uint64_t bucket);
+
+    /// Returns whether a bucket is set in the working version.
+    bool getBucket(uint64_t bucket);
+
+    /// Operations of the writer on a RawItem.
+    bool testItem(RawItem& item);
+    bool testAndAddItem(RawItem& item);
+    bool testAndRemoveItem(RawItem& item);
+
+public:
+    /// Reader is a handle through which one thread looks items up in the
+    /// published version. It holds a reader slot of the filter until it is
+    /// destroyed, and must not outlive the filter.
+    class Reader{
+    private:
+        EpochDeletableBloomFilter* filter; /// Filter read
+        ReaderSlot* slot; /// Slot announcing the epoch of the lookups
+
+        /// Looks an item up in the published version.
+        template <typename Item> bool testItem(Item& item);
+
+    public:
+        /// <summary>
+        /// Claims a reader slot of the filter. Throws std::runtime_error if
+        /// EPOCH_READER_SLOTS readers are already alive.
+        /// </summary>
+        /// <param name="filter">The filter to read</param>
+        explicit Reader(EpochDeletableBloomFilter& filter);
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        ~Reader();
+
+        /// <summary>
+        /// Will test for membership of the data in the published version of
+        /// the filter, without waiting for the writer.
+        /// </summary>
+        /// <param name="data">The data to search for.</param>
+        /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+        bool test(const char* data, int len);
+
+        /// <summary>
+        /// Same as Test, for a key given as a string_view. Throws
+        /// std::invalid_argument if it is longer than INT_MAX bytes.
+        /// </summary>
+        /// <param name="key">The data to search for.</param>
+        /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+        bool test(std::string_view key);
+
+        /// <summary>
+        /// Same as Test, for a key hashed beforehand. Throws
+        /// std::invalid_argument if the key cannot be used with the filter,
+        /// see DeletableBloomFilter.
+        /// </summary>
+        /// <param name="key">The hashed data to search for.</param>
+        /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+        bool test(const HashedKey& key);
+    };
+
+    /// <summary>
+    /// Creates a new EpochDeletableBloomFilter optimized to store n items with
+    /// a specified target false-positive rate, see DeletableBloomFilter. Its
+    /// bucket indices are those of the DeletableBloomFilter built with the same
+    /// parameters.
+    /// </summary>
+    /// <param name="n">Number of items</param>
+    /// <param name="r">Number of bits to use to store collision information</param>
+    /// <param name="fpRate">Desired false positive rate</param>
+    /// <param name="hashScheme">Scheme used to derive the bucket indices</param>
+    /// <param name="powerOfTwo">Whether to round the number of buckets up to a
+    /// power of two, see DeletableBloomFilter</param>
+    /// <param name="seed">Seed of the hashes, see DeletableBloomFilter</param>
+    EpochDeletableBloomFilter(uint64_t n, uint64_t r, double fpRate,
+                              HashScheme hashScheme = HASH_SCHEME_SEEDED,
+                              bool powerOfTwo = false, uint64_t seed = 0);
+
+    EpochDeletableBloomFilter(const EpochDeletableBloomFilter&) = delete;
+    EpochDeletableBloomFilter& operator=(const EpochDeletableBloomFilter&) = delete;
+
+    /// <summary>
+    /// Frees all the versions. No Reader must be alive.
+    /// </summary>
+    ~EpochDeletableBloomFilter();
+
+    /// <summary>
+    /// Returns the number of items added to the filter, including the
+    /// unpublished updates. Writer only.
+    /// </summary>
+    /// <returns>The number of items added to the filter</returns>
+    uint64_t getCount();
+
+    /// <summary>
+    /// Returns the indexer mapping items onto the buckets and buckets onto the
+    /// collision regions of the filter.
+    /// </summary>
+    /// <returns>The indexer of the filter</returns>
+    const Indexer& getIndexer();
+
+    /// <summary>
+    /// Will test for membership of the data in the working version of the
+    /// filter, including the unpublished updates. Writer only, readers go
+    /// through a Reader.
+    /// </summary>
+    /// <param name="data">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const char* data, int len);
+
+    /// <summary>
+    /// Will add the data to the working version of the filter. Writer only,
+    /// the readers see it after the next Publish.
+    /// </summary>
+    /// <param name="data">The data to add.</param>
+    void add(const char* data, int len);
+
+    /// <summary>
+    /// Is equivalent to calling Test followed by Add. It returns true if the data is
+    /// a member, false if not. Writer only.
+    /// </summary>
+    /// <param name="data">The data to test for and add if it doesn't exist.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const char* data, int len);
+
+    /// <summary>
+    /// Will test for membership of the data and remove it from the working
+    /// version of the filter if it exists. Returns true if the data was a
+    /// member, false if not. Writer only.
+    /// </summary>
+    /// <param name="data">The data to test for and remove</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const char* data, int len);
+
+    /// <summary>
+    /// Same as Test, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(std::string_view key);
+
+    /// <summary>
+    /// Same as Add, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to add.</param>
+    void add(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(std::string_view key);
+
+    /// <summary>
+    /// Publishes the working version to the readers, retires the previous one
+    /// and frees the retired versions no reader can still use. Writer only.
+    /// The pages written since the last publication become immutable, and
+    /// are copied again by the next write to them.
+    /// </summary>
+    void publish();
+
+    /// <summary>
+    /// Frees the retired versions no reader can still use, and returns the
+    /// number of versions still waiting. Publish calls it, a writer with no
+    /// more updates to publish can call it to release the memory of versions
+    /// read by stalled readers. Writer only.
+    /// </summary>
+    /// <returns>The number of retired versions not freed yet</returns>
+    size_t reclaim();
+
+    /// <summary>
+    /// Restores the working version of the filter to its original state.
+    /// Writer only, the readers see it after the next Publish.
+    /// </summary>
+    void reset();
+};
+
+#endif // _EPOCH_BF_H_
@@ -0,0 +1,301 @@
+/// FixedDeletableBloomFilter is a DeletableBloomFilter whose geometry is fixed
+/// at compile time: M buckets, K hash functions and R collision regions are
+/// template parameters. The bits are stored inline, so a small filter can be
+/// embedded in another object without any allocation, and the compiler can
+/// unroll the K probes and turn the reductions modulo M and the divisions by
+/// the region size into multiply-shifts by constants.
+///
+/// With the same M, K, R and hash scheme, the filter sets exactly the same bits
+/// as a DeletableBloomFilter with the same seed. fixedBuckets() and
+/// fixedHashes() compute the geometry of DeletableBloomFilter(n, r, fpRate) at
+/// compile time:
+///
+///   FixedDeletableBloomFilter<fixedBuckets(1000, 64, 0.01), fixedHashes(0.01), 64> dbf;
+///
+/// The seed is a run-time argument, so that a secret seed such as randomSeed()
+/// keys HASH_SCHEME_SIPHASH as it does for the other filters.
+
+#ifndef _FIXED_BF_H_
+#define _FIXED_BF_H_
+
+#include "del-bf.h"
+#include "indexer.h"
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+/// <summary>
+/// Returns the natural logarithm of x > 0, at compile time.
+/// </summary>
+constexpr double constexprLog(double x){
+    // x = mantissa * 2^e with the mantissa in [1, 2), and
+    // ln(mantissa) = 2 atanh(y) with y = (mantissa - 1) / (mantissa + 1) < 1/3.
+    int e = 0;
+    while (x >= 2){
+        x /= 2;
+        e++;
+    }
+    while (x < 1){
+        x *= 2;
+        e--;
+    }
+    double y = (x - 1) / (x + 1), y2 = y * y, term = y, sum = 0;
+    for (int i = 1; i < 80; i += 2){
+        sum += term / i;
+        term *= y2;
+    }
+    return 2 * sum + e * 0.693147180559945309417;
+}
+
+/// <summary>
+/// Returns the smallest integer not lower than x >= 0, at compile time.
+/// </summary>
+constexpr uint64_t constexprCeil(double x){
+    uint64_t i = (uint64_t) x;
+    return (double) i < x ? i + 1 : i;
+}
+
+/// <summary>
+/// Returns, at compile time, the number of buckets of a
+/// DeletableBloomFilter(n, r, fpRate), the M of the equivalent
+/// FixedDeletableBloomFilter.
+/// </summary>
+constexpr uint64_t fixedBuckets(uint64_t n, uint64_t r, double fpRate){
+    return constexprCeil((double) n / ((constexprLog(FILL_RATIO) * constexprLog(1 - FILL_RATIO)) /
+                                       -constexprLog(fpRate))) - r;
+}
+
+/// <summary>
+/// Returns, at compile time, the number of hash functions of a
+/// DeletableBloomFilter with the false-positive rate fpRate.
+/// </summary>
+constexpr uint fixedHashes(double fpRate){
+    return constexprCeil(-constexprLog(fpRate) / constexprLog(2));
+}
+
+template <uint64_t M, uint K, uint64_t R, HashScheme S = HASH_SCHEME_SEEDED>
+class FixedDeletableBloomFilter{
+    static_assert(M > 0 && K > 0 && R > 0 && R <= M, "Invalid filter geometry");
+    static_assert(hashSchemeSupported(S), "Hash scheme not supported by this build");
+    static_assert(S != HASH_SCHEME_SEEDED || M <= UINT32_MAX,
+                  "HASH_SCHEME_SEEDED supports at most 2^32 - 1 buckets");
+    static_assert(S != HASH_SCHEME_SEEDED || K <= HASHED_KEY_MAX_SEEDS, "Too many hash functions");
+
+private:
+    /// Number of bits in a region, rounded up so that the last region is R - 1.
+    static constexpr uint64_t REGION_SIZE = (M + R - 1) / R;
+
+    std::array<uint64_t, (M + 63) / 64> buckets; /// Filter data
+    std::array<uint64_t, (R + 63) / 64> collisions; /// Filter collision data
+    uint64_t count; /// Number of items in the filter
+    uint64_t seed; /// Seed of the hashes
+
+    /// Bucket indices of an item.
+    struct Indices{
+        uint64_t idx[K];
+    };
+
+    Indices indices(const char* data, int len) const{
+        Indices r;
+        if (S == HASH_SCHEME_SEEDED){
+            uint32_t h[K];
+            MurmurHash3_x86_32_seeds(data, len, murmurSeed(seed), h, K);
+            for (uint i = 0; i < K; i++){
+                r.idx[i] = h[i] % M;
+            }
+        }else{
+            uint64_t h[2];
+            hashEngine(S, data, len, seed, h);
+            doubleIndices(h, r);
+        }
+        return r;
+    }
+
+    Indices indices(const HashedKey& key) const{
+        if (key.getHashScheme() != S){
+            throw std::invalid_argument("HashedKey hashed with another hash scheme");
+        }
+        if (key.getSeed() != seed){
+            throw std::invalid_argument("HashedKey hashed with another seed");
+        }
+        Indices r;
+        if (S == HASH_SCHEME_SEEDED){
+            if (key.getSeeds() < K){
+                throw std::invalid_argument("HashedKey has fewer seeds than hash functions");
+            }
+            for (uint i = 0; i < K; i++){
+                r.idx[i] = key.getSeeded(i) % M;
+            }
+        }else{
+            doubleIndices(key.getHashes(), r);
+        }
+        return r;
+    }
+
+    static void doubleIndices(const uint64_t* h, Indices& r){
+        // Enhanced double hashing, as in Indexer.
+        for (uint i = 0; i < K; i++){
+            uint64_t x = h[0] + i * h[1] + ((uint64_t) i * i * i - i) / 6;
+            r.idx[i] = ((unsigned __int128) x * M) >> 64;
+        }
+    }
+
+    static bool get(const uint64_t* words, uint64_t i){
+        return (words[i >> 6] >> (i & 63)) & 1;
+    }
+
+    static void set(uint64_t* words, uint64_t i){
+        words[i >> 6] |= (uint64_t) 1 << (i & 63);
+    }
+
+    bool testIndices(const Indices& r) const{
+        // If any of the K bits are not set, then it's not a member.
+        for (uint i = 0; i < K; i++){
+            if (!get(buckets.data(), r.idx[i])){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool testAndAddIndices(const Indices& r){
+        bool member = true;
+        for (uint i = 0; i < K; i++){
+            if (!get(buckets.data(), r.idx[i])){
+                member = false;
+                set(buckets.data(), r.idx[i]);
+            }else{
+                // Collision, set corresponding region bit.
+                set(collisions.data(), r.idx[i] / REGION_SIZE);
+            }
+        }
+        count++;
+        return member;
+    }
+
+    bool testAndRemoveIndices(const Indices& r){
+        if (!testIndices(r)){
+            return false;
+        }
+        for (uint i = 0; i < K; i++){
+            // Clear only bits located in collision-free zones.
+            uint64_t keep = get(collisions.data(), r.idx[i] / REGION_SIZE);
+            buckets[r.idx[i] >> 6] &= ~((1 - keep) << (r.idx[i] & 63));
+        }
+        count--;
+        return true;
+    }
+
+public:
+    /// <summary>
+    /// Creates an empty filter.
+    /// </summary>
+    /// <param name="seed">Seed of the hashes, 0 for the original layout, see
+    /// DeletableBloomFilter</param>
+    explicit FixedDeletableBloomFilter(uint64_t seed = 0) : buckets(), collisions(), count(0), seed(seed){}
+
+    /// <summary>
+    /// Returns the number of items added to the filter.
+    /// </summary>
+    /// <returns>The number of items added to the filter</returns>
+    uint64_t getCount() const{
+        return count;
+    }
+
+    /// <summary>
+    /// Returns the scheme used to derive the bucket indices.
+    /// </summary>
+    /// <returns>The hash scheme of the filter</returns>
+    static constexpr HashScheme getHashScheme(){
+        return S;
+    }
+
+    /// <summary>
+    /// Returns the seed of the hashes.
+    /// </summary>
+    /// <returns>The seed of the filter</returns>
+    uint64_t getSeed() const{
+        return seed;
+    }
+
+    /// <summary>
+    /// Will test for membership of the data and returns true if it is a member,
+    /// false if not. This is a probabilistic test, meaning there is a non-zero
+    /// probability of false positives but a zero probability of false negatives.
+    /// </summary>
+    /// <param name="data">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const char* data, int len) const{
+        return testIndices(indices(data, len));
+    }
+
+    /// <summary>
+    /// Will add the data to the Bloom filter.
+    /// </summary>
+    /// <param name="data">The data to add.</param>
+    void add(const char* data, int len){
+        testAndAddIndices(indices(data, len));
+    }
+
+    /// <summary>
+    /// Is equivalent to calling Test followed by Add. It returns true if the data is
+    /// a member, false if not.
+    /// </summary>
+    /// <param name="data">The data to test for and add if it doesn't exist.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const char* data, int len){
+        return testAndAddIndices(indices(data, len));
+    }
+
+    /// <summary>
+    /// Will test for membership of the data and remove it from the filter if it
+    /// exists. Returns true if the data was a member, false if not.
+    /// </summary>
+    /// <param name="data">The data to test for and remove</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const char* data, int len){
+        return testAndRemoveIndices(indices(data, len));
+    }
+
+    /// <summary>
+    /// Same as Test, for a key hashed beforehand. Throws std::invalid_argument
+    /// if the key was hashed with another scheme or seed, or with fewer seeds
+    /// than K.
+    /// </summary>
+    bool test(const HashedKey& key) const{
+        return testIndices(indices(key));
+    }
+
+    /// <summary>
+    /// Same as Add, for a key hashed beforehand.
+    /// </summary>
+    void add(const HashedKey& key){
+        testAndAddIndices(indices(key));
+    }
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key hashed beforehand.
+    /// </summary>
+    bool testAndAdd(const HashedKey& key){
+        return testAndAddIndices(indices(key));
+    }
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key hashed beforehand.
+    /// </summary>
+    bool testAndRemove(const HashedKey& key){
+        return testAndRemoveIndices(indices(key));
+    }
+
+    /// <summary>
+    /// Restores the Bloom filter to its original state.
+    /// </summary>
+    void reset(){
+        buckets.fill(0);
+        collisions.fill(0);
+        count = 0;
+    }
+};
+
+#endif // _FIXED_BF_H_
@@ -0,0 +1,232 @@
+/// wyhash, CRC32C and SipHash, see hash-engines.h.
+
+#include "hash-engines.h"
+
+#include <random>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CRC32C_SSE42
+#include <nmmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// wyhash final4, by Wang Yi, released into the public domain
+// (https://github.com/wangyi-fudan/wyhash).
+
+static const uint64_t wyp[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+                                0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+static inline void wymum(uint64_t* a, uint64_t* b){
+    unsigned __int128 r = (unsigned __int128) *a * *b;
+    *a = (uint64_t) r;
+    *b = (uint64_t) (r >> 64);
+}
+
+static inline uint64_t wyr8(const uint8_t* p){
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t wyr4(const uint8_t* p){
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t wyr3(const uint8_t* p, size_t k){
+    return ((uint64_t) p[0] << 16) | ((uint64_t) p[k >> 1] << 8) | p[k - 1];
+}
+
+/// <summary>
+/// Returns the 64-bit wyhash final4 of the data, with the default secret.
+/// </summary>
+uint64_t wyhash(const void* data, size_t len, uint64_t seed){
+    const uint8_t* p = (const uint8_t*) data;
+    seed ^= wymix(seed ^ wyp[0], wyp[1]);
+    uint64_t a, b;
+    if (len <= 16){
+        if (len >= 4){
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        }else if (len > 0){
+            a = wyr3(p, len);
+            b = 0;
+        }else{
+            a = b = 0;
+        }
+    }else{
+        size_t i = len;
+        if (i >= 48){
+            uint64_t see1 = seed, see2 = seed;
+            do{
+                seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            }while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16){
+            seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+    a ^= wyp[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+
+//-----------------------------------------------------------------------------
+// CRC32C
+
+/// Reflected Castagnoli polynomial.
+#define CRC32C_POLY (0x82f63b78)
+
+static uint32_t crc32cTable[8][256];
+
+static bool initTable(){
+    for (uint32_t i = 0; i < 256; i++){
+        uint32_t c = i;
+        for (int j = 0; j < 8; j++){
+            c = (c >> 1) ^ (CRC32C_POLY & (0 - (c & 1)));
+        }
+        crc32cTable[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++){
+        for (int t = 1; t < 8; t++){
+            crc32cTable[t][i] = (crc32cTable[t - 1][i] >> 8) ^ crc32cTable[0][crc32cTable[t - 1][i] & 0xff];
+        }
+    }
+    return true;
+}
+
+/// Slicing-by-8 CRC32C, for CPUs without SSE4.2.
+static uint32_t crc32cTables(const uint8_t* p, size_t len, uint32_t crc){
+    static const bool ready = initTable();
+    (void) ready;
+    for (; len >= 8; len -= 8, p += 8){
+        uint64_t w = wyr8(p) ^ crc;
+        crc = crc32cTable[7][w & 0xff] ^ crc32cTable[6][(w >> 8) & 0xff] ^
+              crc32cTable[5][(w >> 16) & 0xff] ^ crc32cTable[4][(w >> 24) & 0xff] ^
+              crc32cTable[3][(w >> 32) & 0xff] ^ crc32cTable[2][(w >> 40) & 0xff] ^
+              crc32cTable[1][(w >> 48) & 0xff] ^ crc32cTable[0][w >> 56];
+    }
+    for (; len; len--, p++){
+        crc = (crc >> 8) ^ crc32cTable[0][(crc ^ *p) & 0xff];
+    }
+    return crc;
+}
+
+#ifdef CRC32C_SSE42
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSse42(const uint8_t* p, size_t len, uint32_t crc){
+    uint64_t c = crc;
+    for (; len >= 8; len -= 8, p += 8){
+        c = _mm_crc32_u64(c, wyr8(p));
+    }
+    crc = c;
+    for (; len; len--, p++){
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+#endif
+
+/// <summary>
+/// Returns the CRC32C (Castagnoli) of the data, starting from crc.
+/// </summary>
+uint32_t crc32c(const void* data, size_t len, uint32_t crc){
+    const uint8_t* p = (const uint8_t*) data;
+    crc = ~crc;
+#ifdef CRC32C_SSE42
+    static const bool sse42 = __builtin_cpu_supports("sse4.2");
+    if (sse42){
+        return ~crc32cSse42(p, len, crc);
+    }
+#endif
+    return ~crc32cTables(p, len, crc);
+}
+
+//-----------------------------------------------------------------------------
+// SipHash-2-4, by Jean-Philippe Aumasson and Daniel J. Bernstein, with the
+// 128-bit output of the reference implementation
+// (https://github.com/veorq/SipHash).
+
+static inline uint64_t siprotl(uint64_t x, int b){
+    return (x << b) | (x >> (64 - b));
+}
+
+static inline void sipround(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3){
+    v0 += v1;
+    v1 = siprotl(v1, 13);
+    v1 ^= v0;
+    v0 = siprotl(v0, 32);
+    v2 += v3;
+    v3 = siprotl(v3, 16);
+    v3 ^= v2;
+    v0 += v3;
+    v3 = siprotl(v3, 21);
+    v3 ^= v0;
+    v2 += v1;
+    v1 = siprotl(v1, 17);
+    v1 ^= v2;
+    v2 = siprotl(v2, 32);
+}
+
+/// <summary>
+/// Computes the 128-bit SipHash-2-4 of the data with the key (k0, k1) into
+/// out[0], out[1].
+/// </summary>
+void siphash128(const void* data, size_t len, uint64_t k0, uint64_t k1, uint64_t* out){
+    const uint8_t* p = (const uint8_t*) data;
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1 ^ 0xee;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    const uint8_t* end = p + (len & ~(size_t) 7);
+    for (; p != end; p += 8){
+        uint64_t m = wyr8(p);
+        v3 ^= m;
+        sipround(v0, v1, v2, v3);
+        sipround(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    uint64_t b = (uint64_t) len << 56;
+    for (size_t i = 0; i < (len & 7); i++){
+        b |= (uint64_t) p[i] << (8 * i);
+    }
+    v3 ^= b;
+    sipround(v0, v1, v2, v3);
+    sipround(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xee;
+    for (int i = 0; i < 4; i++){
+        sipround(v0, v1, v2, v3);
+    }
+    out[0] = v0 ^ v1 ^ v2 ^ v3;
+    v1 ^= 0xdd;
+    for (int i = 0; i < 4; i++){
+        sipround(v0, v1, v2, v3);
+    }
+    out[1] = v0 ^ v1 ^ v2 ^ v3;
+}
+
+//-----------------------------------------------------------------------------
+
+/// <summary>
+/// Returns a seed drawn from the random device of the system, to key the
+/// hashing of a filter.
+/// </summary>
+uint64_t randomSeed(){
+    std::random_device device;
+    return ((uint64_t) device() << 32) ^ device();
+}
@@ -0,0 +1,215 @@
+/// Hash engines of the double hashing schemes. Each engine is a policy struct
+/// whose hash() computes the two 64-bit hashes h[0], h[1] from which Indexer
+/// derives the k bucket indices of an item by enhanced double hashing:
+///
+///   MurmurEngine  MurmurHash3_x64_128 (hash.h), HASH_SCHEME_DOUBLE
+///   WyhashEngine  wyhash final4 by Wang Yi, HASH_SCHEME_WYHASH
+///   Crc32cEngine  CRC32C, with SSE4.2 when the CPU has it, HASH_SCHEME_CRC32C
+///   Xxh3Engine    XXH3_128bits, HASH_SCHEME_XXH3, only when <xxhash.h> is
+///                 available at build time (HASH_ENGINE_XXH3 is then defined)
+///   SipEngine     SipHash-2-4 with 128-bit output, HASH_SCHEME_SIPHASH
+///
+/// CRC32C is the fastest on short keys but only has 32 bits of entropy: items
+/// whose CRCs collide always share their bucket indices, which raises the
+/// false-positive rate floor to about n / 2^32. The other engines hash into
+/// 64 bits or more.
+///
+/// Every engine takes the 64-bit seed of the filter. Only SipHash is a keyed
+/// PRF: without the seed, an attacker cannot craft keys that share bucket
+/// indices. MurmurHash3 and wyhash have seed-independent multicollisions, and
+/// the collisions of CRC32C are linear, so their seeds only defeat
+/// precomputed key sets. Filters exposed to hostile keys should use
+/// HASH_SCHEME_SIPHASH with a seed from randomSeed().
+///
+/// Each engine also hashes keys split into fragments (KeyFragment), with the
+/// same result as the contiguous key. MurmurHash3 and CRC32C are computed
+/// incrementally over the fragments; wyhash and XXH3 gather them into a buffer
+/// on the stack first, or on the heap for keys above FRAGMENT_BUFFER bytes.
+
+#ifndef _HASH_ENGINES_H_
+#define _HASH_ENGINES_H_
+
+#include "hash.h"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#if defined(__has_include)
+#if __has_include(<xxhash.h>)
+#define HASH_ENGINE_XXH3
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+#endif
+#endif
+
+/// <summary>
+/// Returns the 64-bit wyhash final4 of the data, with the default secret.
+/// </summary>
+uint64_t wyhash(const void* data, size_t len, uint64_t seed);
+
+/// <summary>
+/// Returns the CRC32C (Castagnoli) of the data, starting from crc.
+/// </summary>
+uint32_t crc32c(const void* data, size_t len, uint32_t crc = 0);
+
+/// <summary>
+/// Computes the 128-bit SipHash-2-4 of the data with the key (k0, k1) into
+/// out[0], out[1].
+/// </summary>
+void siphash128(const void* data, size_t len, uint64_t k0, uint64_t k1, uint64_t* out);
+
+/// <summary>
+/// Returns a seed drawn from the random device of the system, to key the
+/// hashing of a filter.
+/// </summary>
+uint64_t randomSeed();
+
+/// <summary>
+/// Folds a 64-bit seed into the 32-bit seed of MurmurHash3. Seed 0 is
+/// unchanged, so that unseeded filters keep the original layout.
+/// </summary>
+constexpr uint32_t murmurSeed(uint64_t seed){
+    return (uint32_t) seed ^ (uint32_t) (seed >> 32);
+}
+
+/// <summary>
+/// Mixes two 64-bit words into one with a 64x64->128-bit multiplication, as
+/// wyhash does.
+/// </summary>
+inline uint64_t wymix(uint64_t a, uint64_t b){
+    unsigned __int128 r = (unsigned __int128) a * b;
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+}
+
+/// Size of the stack buffer in which FragmentBuffer gathers a key.
+#define FRAGMENT_BUFFER (256)
+
+/// KeyFragment is one piece of a key split across several buffers, as an
+/// iovec: the key is the concatenation of its fragments in order.
+struct KeyFragment{
+    const char* data; /// Fragment data
+    int len; /// Length of the fragment
+};
+
+/// FragmentBuffer gathers the fragments of a key into contiguous memory, for
+/// the engines that cannot hash them incrementally.
+class FragmentBuffer{
+private:
+    char stack[FRAGMENT_BUFFER]; /// Storage of keys of up to FRAGMENT_BUFFER bytes
+    std::string heap; /// Storage of longer keys
+    const char* data; /// The gathered key
+    int len; /// Length of the key
+
+public:
+    FragmentBuffer(const KeyFragment* fragments, size_t n) : data(stack), len(0){
+        if (n == 1){
+            // Already contiguous.
+            data = fragments[0].data;
+            len = fragments[0].len;
+            return;
+        }
+        for (size_t i = 0; i < n; i++){
+            len += fragments[i].len;
+        }
+        char* p = stack;
+        if (len > FRAGMENT_BUFFER){
+            heap.resize(len);
+            p = &heap[0];
+            data = p;
+        }
+        for (size_t i = 0; i < n; i++){
+            memcpy(p, fragments[i].data, fragments[i].len);
+            p += fragments[i].len;
+        }
+    }
+
+    const char* getData() const{
+        return data;
+    }
+
+    int getLen() const{
+        return len;
+    }
+};
+
+struct MurmurEngine{
+    static void hash(const char* data, int len, uint64_t seed, uint64_t* h){
+        MurmurHash128 r = MurmurHash3_x64_128(data, len, murmurSeed(seed));
+        h[0] = r.h1;
+        h[1] = r.h2;
+    }
+
+    static void hash(const KeyFragment* fragments, size_t n, uint64_t seed, uint64_t* h){
+        MurmurHash3_x64_128_state state;
+        MurmurHash3_x64_128_init(&state, murmurSeed(seed));
+        for (size_t i = 0; i < n; i++){
+            MurmurHash3_x64_128_update(&state, fragments[i].data, fragments[i].len);
+        }
+        MurmurHash128 r = MurmurHash3_x64_128_final(&state);
+        h[0] = r.h1;
+        h[1] = r.h2;
+    }
+};
+
+struct WyhashEngine{
+    static void hash(const char* data, int len, uint64_t seed, uint64_t* h){
+        h[0] = wyhash(data, len, seed);
+        // wyhash returns 64 bits, the second hash is derived from the first.
+        h[1] = wymix(h[0] ^ 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL);
+    }
+
+    static void hash(const KeyFragment* fragments, size_t n, uint64_t seed, uint64_t* h){
+        FragmentBuffer key(fragments, n);
+        hash(key.getData(), key.getLen(), seed, h);
+    }
+};
+
+struct Crc32cEngine{
+    static void hash(const char* data, int len, uint64_t seed, uint64_t* h){
+        mix(crc32c(data, len), seed, h);
+    }
+
+    static void hash(const KeyFragment* fragments, size_t n, uint64_t seed, uint64_t* h){
+        uint32_t c = 0;
+        for (size_t i = 0; i < n; i++){
+            c = crc32c(fragments[i].data, fragments[i].len, c);
+        }
+        mix(c, seed, h);
+    }
+
+    static void mix(uint64_t c, uint64_t seed, uint64_t* h){
+        c ^= seed;
+        h[0] = wymix(c ^ 0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL);
+        h[1] = wymix(c ^ 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL);
+    }
+};
+
+#ifdef HASH_ENGINE_XXH3
+struct Xxh3Engine{
+    static void hash(const char* data, int len, uint64_t seed, uint64_t* h){
+        XXH128_hash_t x = XXH3_128bits_withSeed(data, len, seed);
+        h[0] = x.low64;
+        h[1] = x.high64;
+    }
+
+    static void hash(const KeyFragment* fragments, size_t n, uint64_t seed, uint64_t* h){
+        FragmentBuffer key(fragments, n);
+        hash(key.getData(), key.getLen(), seed, h);
+    }
+};
+#endif
+
+struct SipEngine{
+    static void hash(const char* data, int len, uint64_t seed, uint64_t* h){
+        // The 64-bit seed is expanded into the 128-bit key.
+        siphash128(data, len, seed, wymix(seed ^ 0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL), h);
+    }
+
+    static void hash(const KeyFragment* fragments, size_t n, uint64_t seed, uint64_t* h){
+        FragmentBuffer key(fragments, n);
+        hash(key.getData(), key.getLen(), seed, h);
+    }
+};
+
+#endif // _HASH_ENGINES_H_
@@ -0,0 +1,289 @@
+/// Vectorized MurmurHash3_x86_32 kernels, see hash-simd.h. Each kernel follows
+/// MurmurHash3_x86_32 in hash.cpp step by step, one input per lane.
+
+#include "hash-simd.h"
+#include "hash.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MURMUR_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#define MURMUR_C1 (0xcc9e2d51)
+#define MURMUR_C2 (0x1b873593)
+
+enum SimdLevel{
+    SIMD_SCALAR,
+    SIMD_AVX2,
+    SIMD_AVX512
+};
+
+static SimdLevel simdLevel(){
+#ifdef MURMUR_SIMD_X86
+    static const SimdLevel level = [](){
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")){
+            return SIMD_AVX512;
+        }
+        if (__builtin_cpu_supports("avx2")){
+            return SIMD_AVX2;
+        }
+        return SIMD_SCALAR;
+    }();
+    return level;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+/// Returns the last len % 4 bytes of a key as a little-endian word.
+static inline uint32_t tailWord(const void* key, int len){
+    const uint8_t* tail = (const uint8_t*) key + (len & ~3);
+    uint32_t k1 = 0;
+    switch (len & 3){
+    case 3: k1 ^= tail[2] << 16; // fallthrough
+    case 2: k1 ^= tail[1] << 8; // fallthrough
+    case 1: k1 ^= tail[0];
+    }
+    return k1;
+}
+
+/// Returns the block or tail word k1 of MurmurHash3_x86_32 mixed, ready to be
+/// XORed into h1.
+static inline uint32_t mixWord(uint32_t k1){
+    k1 *= MURMUR_C1;
+    k1 = (k1 << 15) | (k1 >> 17);
+    return k1 * MURMUR_C2;
+}
+
+#ifdef MURMUR_SIMD_X86
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+
+template <int R>
+TARGET_AVX2 static inline __m256i rotl(__m256i x){
+    return _mm256_or_si256(_mm256_slli_epi32(x, R), _mm256_srli_epi32(x, 32 - R));
+}
+
+TARGET_AVX2 static inline __m256i mix(__m256i h1, __m256i k1){
+    k1 = _mm256_mullo_epi32(k1, _mm256_set1_epi32(MURMUR_C1));
+    k1 = rotl<15>(k1);
+    k1 = _mm256_mullo_epi32(k1, _mm256_set1_epi32(MURMUR_C2));
+    return _mm256_xor_si256(h1, k1);
+}
+
+TARGET_AVX2 static inline __m256i step(__m256i h1){
+    h1 = rotl<13>(h1);
+    return _mm256_add_epi32(_mm256_mullo_epi32(h1, _mm256_set1_epi32(5)),
+                            _mm256_set1_epi32(0xe6546b64));
+}
+
+TARGET_AVX2 static inline __m256i fmix(__m256i h){
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x85ebca6b));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0xc2b2ae35));
+    return _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+}
+
+/// Hashes 8 keys.
+TARGET_AVX2 static void keysAvx2(const void* const* keys, int len, uint32_t seed, uint32_t* out){
+    const int nblocks = len / 4;
+    // The blocks are gathered through the key pointers, 4 lanes at a time.
+    __m256i lo = _mm256_loadu_si256((const __m256i*) keys);
+    __m256i hi = _mm256_loadu_si256((const __m256i*) (keys + 4));
+    __m256i h1 = _mm256_set1_epi32(seed);
+    for (int i = 0; i < nblocks; i++){
+        __m128i klo = _mm256_i64gather_epi32((const int*) 0, lo, 1);
+        __m128i khi = _mm256_i64gather_epi32((const int*) 0, hi, 1);
+        __m256i k1 = _mm256_inserti128_si256(_mm256_castsi128_si256(klo), khi, 1);
+        h1 = step(mix(h1, k1));
+        lo = _mm256_add_epi64(lo, _mm256_set1_epi64x(4));
+        hi = _mm256_add_epi64(hi, _mm256_set1_epi64x(4));
+    }
+    if (len & 3){
+        uint32_t tail[8];
+        for (int j = 0; j < 8; j++){
+            tail[j] = tailWord(keys[j], len);
+        }
+        h1 = mix(h1, _mm256_loadu_si256((const __m256i*) tail));
+    }
+    h1 = fmix(_mm256_xor_si256(h1, _mm256_set1_epi32(len)));
+    _mm256_storeu_si256((__m256i*) out, h1);
+}
+
+/// Hashes one key with the n <= 8 seeds seed..seed+n-1. The blocks are the
+/// same for every seed, so they are mixed once and broadcast to the lanes.
+TARGET_AVX2 static void seedsAvx2(const void* key, int len, uint32_t seed, uint32_t* out, size_t n){
+    const int nblocks = len / 4;
+    const char* data = (const char*) key;
+    __m256i h1 = _mm256_add_epi32(_mm256_set1_epi32(seed), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    for (int i = 0; i < nblocks; i++){
+        uint32_t k1;
+        memcpy(&k1, data + i * 4, 4);
+        h1 = step(_mm256_xor_si256(h1, _mm256_set1_epi32(mixWord(k1))));
+    }
+    if (len & 3){
+        h1 = _mm256_xor_si256(h1, _mm256_set1_epi32(mixWord(tailWord(key, len))));
+    }
+    h1 = fmix(_mm256_xor_si256(h1, _mm256_set1_epi32(len)));
+    uint32_t hashes[8];
+    _mm256_storeu_si256((__m256i*) hashes, h1);
+    memcpy(out, hashes, n * sizeof(uint32_t));
+}
+
+// GCC 12 warns about the deliberately undefined source operands the AVX-512
+// intrinsics pass to the unmasked instructions.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+TARGET_AVX512 static inline __m512i mix(__m512i h1, __m512i k1){
+    k1 = _mm512_mullo_epi32(k1, _mm512_set1_epi32(MURMUR_C1));
+    k1 = _mm512_rol_epi32(k1, 15);
+    k1 = _mm512_mullo_epi32(k1, _mm512_set1_epi32(MURMUR_C2));
+    return _mm512_xor_si512(h1, k1);
+}
+
+TARGET_AVX512 static inline __m512i step(__m512i h1){
+    h1 = _mm512_rol_epi32(h1, 13);
+    return _mm512_add_epi32(_mm512_mullo_epi32(h1, _mm512_set1_epi32(5)),
+                            _mm512_set1_epi32(0xe6546b64));
+}
+
+TARGET_AVX512 static inline __m512i fmix(__m512i h){
+    h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+    h = _mm512_mullo_epi32(h, _mm512_set1_epi32(0x85ebca6b));
+    h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 13));
+    h = _mm512_mullo_epi32(h, _mm512_set1_epi32(0xc2b2ae35));
+    return _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+}
+
+/// Hashes 16 keys.
+TARGET_AVX512 static void keysAvx512(const void* const* keys, int len, uint32_t seed, uint32_t* out){
+    const int nblocks = len / 4;
+    __m512i lo = _mm512_loadu_si512((const void*) keys);
+    __m512i hi = _mm512_loadu_si512((const void*) (keys + 8));
+    __m512i h1 = _mm512_set1_epi32(seed);
+    for (int i = 0; i < nblocks; i++){
+        __m256i klo = _mm512_i64gather_epi32(lo, (const void*) 0, 1);
+        __m256i khi = _mm512_i64gather_epi32(hi, (const void*) 0, 1);
+        __m512i k1 = _mm512_inserti64x4(_mm512_castsi256_si512(klo), khi, 1);
+        h1 = step(mix(h1, k1));
+        lo = _mm512_add_epi64(lo, _mm512_set1_epi64(4));
+        hi = _mm512_add_epi64(hi, _mm512_set1_epi64(4));
+    }
+    if (len & 3){
+        uint32_t tail[16];
+        for (int j = 0; j < 16; j++){
+            tail[j] = tailWord(keys[j], len);
+        }
+        h1 = mix(h1, _mm512_loadu_si512((const void*) tail));
+    }
+    h1 = fmix(_mm512_xor_si512(h1, _mm512_set1_epi32(len)));
+    _mm512_storeu_si512((void*) out, h1);
+}
+
+/// Hashes one key with the n <= 16 seeds seed..seed+n-1.
+TARGET_AVX512 static void seedsAvx512(const void* key, int len, uint32_t seed, uint32_t* out, size_t n){
+    const int nblocks = len / 4;
+    const char* data = (const char*) key;
+    __m512i h1 = _mm512_add_epi32(_mm512_set1_epi32(seed),
+                                  _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+    for (int i = 0; i < nblocks; i++){
+        uint32_t k1;
+        memcpy(&k1, data + i * 4, 4);
+        h1 = step(_mm512_xor_si512(h1, _mm512_set1_epi32(mixWord(k1))));
+    }
+    if (len & 3){
+        h1 = _mm512_xor_si512(h1, _mm512_set1_epi32(mixWord(tailWord(key, len))));
+    }
+    h1 = fmix(_mm512_xor_si512(h1, _mm512_set1_epi32(len)));
+    uint32_t hashes[16];
+    _mm512_storeu_si512((void*) hashes, h1);
+    memcpy(out, hashes, n * sizeof(uint32_t));
+}
+
+#pragma GCC diagnostic pop
+
+#endif // MURMUR_SIMD_X86
+
+/// <summary>
+/// Hashes n keys of the same length with the same seed: out[j] is
+/// MurmurHash3_x86_32(keys[j], len, seed).
+/// </summary>
+/// <param name="keys">The keys to hash</param>
+/// <param name="len">Length of every key in bytes</param>
+/// <param name="seed">Hash seed</param>
+/// <param name="out">Receives the n hashes</param>
+/// <param name="n">Number of keys</param>
+void MurmurHash3_x86_32_keys(const void* const* keys, int len, uint32_t seed, uint32_t* out, size_t n){
+    size_t j = 0;
+#ifdef MURMUR_SIMD_X86
+    SimdLevel level = simdLevel();
+    if (level >= SIMD_AVX512){
+        for (; j + 16 <= n; j += 16){
+            keysAvx512(keys + j, len, seed, out + j);
+        }
+    }
+    if (level >= SIMD_AVX2){
+        for (; j + 8 <= n; j += 8){
+            keysAvx2(keys + j, len, seed, out + j);
+        }
+    }
+#endif
+    for (; j < n; j++){
+        out[j] = MurmurHash3_x86_32((const char*) keys[j], len, seed);
+    }
+}
+
+/// <summary>
+/// Hashes one key with n consecutive seeds: out[i] is
+/// MurmurHash3_x86_32(key, len, seed + i).
+/// </summary>
+/// <param name="key">The key to hash</param>
+/// <param name="len">Length of the key in bytes</param>
+/// <param name="seed">First seed</param>
+/// <param name="out">Receives the n hashes</param>
+/// <param name="n">Number of seeds</param>
+void MurmurHash3_x86_32_seeds(const void* key, int len, uint32_t seed, uint32_t* out, size_t n){
+    size_t i = 0;
+#ifdef MURMUR_SIMD_X86
+    SimdLevel level = simdLevel();
+    // A partially used vector still beats hashing the seeds one at a time.
+    while (n - i > 1){
+        size_t lanes = n - i;
+        if (level >= SIMD_AVX512 && lanes > 8){
+            lanes = lanes < 16 ? lanes : 16;
+            seedsAvx512(key, len, seed + i, out + i, lanes);
+        }else if (level >= SIMD_AVX2){
+            lanes = lanes < 8 ? lanes : 8;
+            seedsAvx2(key, len, seed + i, out + i, lanes);
+        }else{
+            break;
+        }
+        i += lanes;
+    }
+#endif
+    for (; i < n; i++){
+        out[i] = MurmurHash3_x86_32((const char*) key, len, seed + i);
+    }
+}
+
+/// <summary>
+/// Returns the name of the kernel selected for this CPU: "avx512", "avx2" or
+/// "scalar".
+/// </summary>
+const char* murmurSimdLevel(){
+    switch (simdLevel()){
+    case SIMD_AVX512:
+        return "avx512";
+    case SIMD_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,42 @@
+/// Vectorized MurmurHash3_x86_32 kernels. They run the hash of several inputs
+/// in the lanes of a SIMD register and return exactly the same values as
+/// MurmurHash3_x86_32: either several keys with the same seed, or the same key
+/// with several seeds. The widest kernel supported by the CPU is selected at
+/// run time (AVX-512: 16 lanes, AVX2: 8 lanes), with a scalar fallback for
+/// other CPUs and for the inputs left over by the full vectors.
+
+#ifndef _HASH_SIMD_H_
+#define _HASH_SIMD_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// Hashes n keys of the same length with the same seed: out[j] is
+/// MurmurHash3_x86_32(keys[j], len, seed).
+/// </summary>
+/// <param name="keys">The keys to hash</param>
+/// <param name="len">Length of every key in bytes</param>
+/// <param name="seed">Hash seed</param>
+/// <param name="out">Receives the n hashes</param>
+/// <param name="n">Number of keys</param>
+void MurmurHash3_x86_32_keys(const void* const* keys, int len, uint32_t seed, uint32_t* out, size_t n);
+
+/// <summary>
+/// Hashes one key with n consecutive seeds: out[i] is
+/// MurmurHash3_x86_32(key, len, seed + i).
+/// </summary>
+/// <param name="key">The key to hash</param>
+/// <param name="len">Length of the key in bytes</param>
+/// <param name="seed">First seed</param>
+/// <param name="out">Receives the n hashes</param>
+/// <param name="n">Number of seeds</param>
+void MurmurHash3_x86_32_seeds(const void* key, int len, uint32_t seed, uint32_t* out, size_t n);
+
+/// <summary>
+/// Returns the name of the kernel selected for this CPU: "avx512", "avx2" or
+/// "scalar".
+/// </summary>
+const char* murmurSimdLevel();
+
+#endif // _HASH_SIMD_H_
@@ -54,39 +54,7 @@ inline uint64_t rotl64 ( uint64_t x, int8_t r )
 
 FORCE_INLINE uint32_t getblock32 ( const uint32_t * p, int i )
 {
-  return p[i];
-}
-
-FORCE_INLINE uint64_t getblock64 ( const uint64_t * p, int i )
-{
-  return p[i];
-}
-
-//-----------------------------------------------------------------------------
-// Finalization mix - force all bits of a hash block to avalanche
-
-FORCE_INLINE uint32_t fmix32 ( uint32_t h )
-{
-  h ^= h >> 16;
-  h *= 0x85ebca6b;
-  h ^= h >> 13;
-  h *= 0xc2b2ae35;
-  h ^= h >> 16;
-
-  return h;
-}
-
-//----------
-
-FORCE_INLINE uint64_t fmix64 ( uint64_t k )
-{
-  k ^= k >> 33;
-  k *= BIG_CONSTANT(0xff51afd7ed558ccd);
-  k ^= k >> 33;
-  k *= BIG_CONSTANT(0xc4ceb9fe1a85ec53);
-  k ^= k >> 33;
-
-  return k;
+  return murmur_getblock32((const char*)(p + i));
 }
 
 //-----------------------------------------------------------------------------
@@ -94,56 +62,9 @@ FORCE_INLINE uint64_t fmix64 ( uint64_t k )
 void MurmurHash3_x86_32 ( const void * key, int len,
                           uint32_t seed, void * out )
 {
-  const uint8_t * data = (const uint8_t*)key;
-  const int nblocks = len / 4;
-
-  uint32_t h1 = seed;
-
-  const uint32_t c1 = 0xcc9e2d51;
-  const uint32_t c2 = 0x1b873593;
-
-  //----------
-  // body
-
-  const uint32_t * blocks = (const uint32_t *)(data + nblocks*4);
-
-  for(int i = -nblocks; i; i++)
-  {
-    uint32_t k1 = getblock32(blocks,i);
-
-    k1 *= c1;
-    k1 = ROTL32(k1,15);
-    k1 *= c2;
-    
-    h1 ^= k1;
-    h1 = ROTL32(h1,13); 
-    h1 = h1*5+0xe6546b64;
-  }
-
-  //----------
-  // tail
-
-  const uint8_t * tail = (const uint8_t*)(data + nblocks*4);
-
-  uint32_t k1 = 0;
-
-  switch(len & 3)
-  {
-  case 3: k1 ^= tail[2] << 16;
-  case 2: k1 ^= tail[1] << 8;
-  case 1: k1 ^= tail[0];
-          k1 *= c1; k1 = ROTL32(k1,15); k1 *= c2; h1 ^= k1;
-  };
-
-  //----------
-  // finalization
-
-  h1 ^= len;
-
-  h1 = fmix32(h1);
-
-  *(uint32_t*)out = h1;
-} 
+  uint32_t h1 = MurmurHash3_x86_32((const char*)key, len, seed);
+  memcpy(out, &h1, 4);
+}
 
 //-----------------------------------------------------------------------------
 
@@ -255,68 +176,160 @@ void MurmurHash3_x86_128 ( const void * key, const int len,
 void MurmurHash3_x64_128 ( const void * key, const int len,
                            const uint32_t seed, void * out )
 {
-  const uint8_t * data = (const uint8_t*)key;
-  const int nblocks = len / 16;
+  MurmurHash128 h = MurmurHash3_x64_128((const char*)key, len, seed);
+  memcpy(out, &h.h1, 8);
+  memcpy((char*)out + 8, &h.h2, 8);
+}
 
-  uint64_t h1 = seed;
-  uint64_t h2 = seed;
+//-----------------------------------------------------------------------------
+// Incremental versions, the block and tail steps are those of the functions
+// in hash.h.
 
-  const uint64_t c1 = BIG_CONSTANT(0x87c37b91114253d5);
-  const uint64_t c2 = BIG_CONSTANT(0x4cf5ad432745937f);
+FORCE_INLINE uint32_t x86_32_block ( uint32_t h1, uint32_t k1 )
+{
+  k1 *= 0xcc9e2d51;
+  k1 = ROTL32(k1,15);
+  k1 *= 0x1b873593;
 
-  //----------
-  // body
+  h1 ^= k1;
+  h1 = ROTL32(h1,13);
+  return h1*5+0xe6546b64;
+}
 
-  const uint64_t * blocks = (const uint64_t *)(data);
+void MurmurHash3_x86_32_init ( MurmurHash3_x86_32_state * state, uint32_t seed )
+{
+  state->h1 = seed;
+  state->tail = 0;
+  state->len = 0;
+}
+
+void MurmurHash3_x86_32_update ( MurmurHash3_x86_32_state * state, const void * key, int len )
+{
+  const char * data = (const char*)key;
+  uint32_t pending = state->len & 3;
+
+  state->len += len;
+
+  // Complete the partial block.
+  if(pending)
+  {
+    for(; len && pending < 4; len--, pending++)
+      state->tail |= (uint32_t)(uint8_t)*data++ << (pending * 8);
+
+    if(pending < 4) return;
+
+    state->h1 = x86_32_block(state->h1, state->tail);
+    state->tail = 0;
+  }
+
+  const int nblocks = len / 4;
 
   for(int i = 0; i < nblocks; i++)
+    state->h1 = x86_32_block(state->h1, murmur_getblock32(data + i*4));
+
+  data += nblocks*4;
+
+  for(int i = 0; i < (len & 3); i++)
+    state->tail |= (uint32_t)(uint8_t)data[i] << (i * 8);
+}
+
+uint32_t MurmurHash3_x86_32_final ( const MurmurHash3_x86_32_state * state )
+{
+  uint32_t h1 = state->h1;
+
+  if(state->len & 3)
   {
-    uint64_t k1 = getblock64(blocks,i*2+0);
-    uint64_t k2 = getblock64(blocks,i*2+1);
+    uint32_t k1 = state->tail;
+    k1 *= 0xcc9e2d51; k1 = ROTL32(k1,15); k1 *= 0x1b873593; h1 ^= k1;
+  }
 
-    k1 *= c1; k1  = ROTL64(k1,31); k1 *= c2; h1 ^= k1;
+  h1 ^= state->len;
+
+  return fmix32(h1);
+}
 
-    h1 = ROTL64(h1,27); h1 += h2; h1 = h1*5+0x52dce729;
+//-----------------------------------------------------------------------------
 
-    k2 *= c2; k2  = ROTL64(k2,33); k2 *= c1; h2 ^= k2;
+FORCE_INLINE void x64_128_block ( uint64_t & h1, uint64_t & h2, uint64_t k1, uint64_t k2 )
+{
+  const uint64_t c1 = BIG_CONSTANT(0x87c37b91114253d5);
+  const uint64_t c2 = BIG_CONSTANT(0x4cf5ad432745937f);
+
+  k1 *= c1; k1  = ROTL64(k1,31); k1 *= c2; h1 ^= k1;
+
+  h1 = ROTL64(h1,27); h1 += h2; h1 = h1*5+0x52dce729;
 
-    h2 = ROTL64(h2,31); h2 += h1; h2 = h2*5+0x38495ab5;
+  k2 *= c2; k2  = ROTL64(k2,33); k2 *= c1; h2 ^= k2;
+
+  h2 = ROTL64(h2,31); h2 += h1; h2 = h2*5+0x38495ab5;
+}
+
+void MurmurHash3_x64_128_init ( MurmurHash3_x64_128_state * state, uint32_t seed )
+{
+  state->h1 = seed;
+  state->h2 = seed;
+  state->len = 0;
+}
+
+void MurmurHash3_x64_128_update ( MurmurHash3_x64_128_state * state, const void * key, int len )
+{
+  const char * data = (const char*)key;
+  uint32_t pending = state->len & 15;
+
+  state->len += len;
+
+  // Complete the partial block.
+  if(pending)
+  {
+    uint32_t n = 16 - pending < (uint32_t)len ? 16 - pending : (uint32_t)len;
+    memcpy(state->tail + pending, data, n);
+    data += n;
+    len -= n;
+
+    if(pending + n < 16) return;
+
+    x64_128_block(state->h1, state->h2, murmur_getblock64((const char*)state->tail),
+                  murmur_getblock64((const char*)state->tail + 8));
   }
 
-  //----------
-  // tail
+  const int nblocks = len / 16;
 
-  const uint8_t * tail = (const uint8_t*)(data + nblocks*16);
+  for(int i = 0; i < nblocks; i++)
+    x64_128_block(state->h1, state->h2, murmur_getblock64(data + i*16),
+                  murmur_getblock64(data + i*16 + 8));
+
+  memcpy(state->tail, data + nblocks*16, len & 15);
+}
+
+MurmurHash128 MurmurHash3_x64_128_final ( const MurmurHash3_x64_128_state * state )
+{
+  const uint64_t c1 = BIG_CONSTANT(0x87c37b91114253d5);
+  const uint64_t c2 = BIG_CONSTANT(0x4cf5ad432745937f);
+
+  uint64_t h1 = state->h1;
+  uint64_t h2 = state->h2;
+  const uint32_t rem = state->len & 15;
 
   uint64_t k1 = 0;
   uint64_t k2 = 0;
 
-  switch(len & 15)
+  for(uint32_t i = rem; i > 8; i--)
+    k2 = (k2 << 8) | state->tail[i - 1];
+
+  if(rem > 8)
   {
-  case 15: k2 ^= ((uint64_t)tail[14]) << 48;
-  case 14: k2 ^= ((uint64_t)tail[13]) << 40;
-  case 13: k2 ^= ((uint64_t)tail[12]) << 32;
-  case 12: k2 ^= ((uint64_t)tail[11]) << 24;
-  case 11: k2 ^= ((uint64_t)tail[10]) << 16;
-  case 10: k2 ^= ((uint64_t)tail[ 9]) << 8;
-  case  9: k2 ^= ((uint64_t)tail[ 8]) << 0;
-           k2 *= c2; k2  = ROTL64(k2,33); k2 *= c1; h2 ^= k2;
-
-  case  8: k1 ^= ((uint64_t)tail[ 7]) << 56;
-  case  7: k1 ^= ((uint64_t)tail[ 6]) << 48;
-  case  6: k1 ^= ((uint64_t)tail[ 5]) << 40;
-  case  5: k1 ^= ((uint64_t)tail[ 4]) << 32;
-  case  4: k1 ^= ((uint64_t)tail[ 3]) << 24;
-  case  3: k1 ^= ((uint64_t)tail[ 2]) << 16;
-  case  2: k1 ^= ((uint64_t)tail[ 1]) << 8;
-  case  1: k1 ^= ((uint64_t)tail[ 0]) << 0;
-           k1 *= c1; k1  = ROTL64(k1,31); k1 *= c2; h1 ^= k1;
-  };
+    k2 *= c2; k2  = ROTL64(k2,33); k2 *= c1; h2 ^= k2;
+  }
 
-  //----------
-  // finalization
+  for(uint32_t i = rem < 8 ? rem : 8; i > 0; i--)
+    k1 = (k1 << 8) | state->tail[i - 1];
 
-  h1 ^= len; h2 ^= len;
+  if(rem)
+  {
+    k1 *= c1; k1  = ROTL64(k1,31); k1 *= c2; h1 ^= k1;
+  }
+
+  h1 ^= state->len; h2 ^= state->len;
 
   h1 += h2;
   h2 += h1;
@@ -327,8 +340,7 @@ void MurmurHash3_x64_128 ( const void * key, const int len,
   h1 += h2;
   h2 += h1;
 
-  ((uint64_t*)out)[0] = h1;
-  ((uint64_t*)out)[1] = h2;
+  return MurmurHash128{h1, h2};
 }
 
-//-----------------------------------------------------------------------------
\ No newline at end of file
+//-----------------------------------------------------------------------------
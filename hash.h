@@ -32,6 +32,304 @@ void MurmurHash3_x86_128 ( const void * key, int len, uint32_t seed, void * out
 
 void MurmurHash3_x64_128 ( const void * key, int len, uint32_t seed, void * out );
 
+//-----------------------------------------------------------------------------
+// Value-returning versions of MurmurHash3_x86_32 and MurmurHash3_x64_128, which
+// the functions above wrap. They are constexpr, so that the hashes of constant
+// keys can be computed at compile time, and inline, so that the hash of a
+// probe loop can be inlined and keeps its result in registers. The blocks are
+// read as little-endian words with memcpy at run time, and byte by byte during
+// constant evaluation, which gives the same results.
+
+#include <string.h>
+
+struct MurmurHash128
+{
+  uint64_t h1;
+  uint64_t h2;
+};
+
+constexpr uint32_t murmur_rotl32 ( uint32_t x, int r )
+{
+  return (x << r) | (x >> (32 - r));
+}
+
+constexpr uint64_t murmur_rotl64 ( uint64_t x, int r )
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+constexpr uint32_t murmur_getblock32 ( const char * p )
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if(!__builtin_is_constant_evaluated())
+  {
+    uint32_t v = 0;
+    memcpy(&v, p, 4);
+    return v;
+  }
+#endif
+  return (uint32_t)(uint8_t)p[0] | (uint32_t)(uint8_t)p[1] << 8 |
+         (uint32_t)(uint8_t)p[2] << 16 | (uint32_t)(uint8_t)p[3] << 24;
+}
+
+constexpr uint64_t murmur_getblock64 ( const char * p )
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if(!__builtin_is_constant_evaluated())
+  {
+    uint64_t v = 0;
+    memcpy(&v, p, 8);
+    return v;
+  }
+#endif
+  return (uint64_t)murmur_getblock32(p) | (uint64_t)murmur_getblock32(p + 4) << 32;
+}
+
+//-----------------------------------------------------------------------------
+// Finalization mix - force all bits of a hash block to avalanche
+
+constexpr uint32_t fmix32 ( uint32_t h )
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+
+  return h;
+}
+
+constexpr uint64_t fmix64 ( uint64_t k )
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+
+  return k;
+}
+
+//-----------------------------------------------------------------------------
+
+constexpr uint32_t MurmurHash3_x86_32 ( const char * data, int len, uint32_t seed )
+{
+  const int nblocks = len / 4;
+
+  uint32_t h1 = seed;
+
+  const uint32_t c1 = 0xcc9e2d51;
+  const uint32_t c2 = 0x1b873593;
+
+  //----------
+  // body
+
+  for(int i = 0; i < nblocks; i++)
+  {
+    uint32_t k1 = murmur_getblock32(data + i*4);
+
+    k1 *= c1;
+    k1 = murmur_rotl32(k1,15);
+    k1 *= c2;
+
+    h1 ^= k1;
+    h1 = murmur_rotl32(h1,13);
+    h1 = h1*5+0xe6546b64;
+  }
+
+  //----------
+  // tail
+
+  const char * tail = data + nblocks*4;
+
+  uint32_t k1 = 0;
+
+  switch(len & 3)
+  {
+  case 3: k1 ^= (uint32_t)(uint8_t)tail[2] << 16; // fallthrough
+  case 2: k1 ^= (uint32_t)(uint8_t)tail[1] << 8; // fallthrough
+  case 1: k1 ^= (uint32_t)(uint8_t)tail[0];
+          k1 *= c1; k1 = murmur_rotl32(k1,15); k1 *= c2; h1 ^= k1;
+  };
+
+  //----------
+  // finalization
+
+  h1 ^= len;
+
+  return fmix32(h1);
+}
+
+//-----------------------------------------------------------------------------
+
+constexpr MurmurHash128 MurmurHash3_x64_128 ( const char * data, int len, uint32_t seed )
+{
+  const int nblocks = len / 16;
+
+  uint64_t h1 = seed;
+  uint64_t h2 = seed;
+
+  const uint64_t c1 = 0x87c37b91114253d5ULL;
+  const uint64_t c2 = 0x4cf5ad432745937fULL;
+
+  //----------
+  // body
+
+  for(int i = 0; i < nblocks; i++)
+  {
+    uint64_t k1 = murmur_getblock64(data + i*16);
+    uint64_t k2 = murmur_getblock64(data + i*16 + 8);
+
+    k1 *= c1; k1  = murmur_rotl64(k1,31); k1 *= c2; h1 ^= k1;
+
+    h1 = murmur_rotl64(h1,27); h1 += h2; h1 = h1*5+0x52dce729;
+
+    k2 *= c2; k2  = murmur_rotl64(k2,33); k2 *= c1; h2 ^= k2;
+
+    h2 = murmur_rotl64(h2,31); h2 += h1; h2 = h2*5+0x38495ab5;
+  }
+
+  //----------
+  // tail
+
+  const char * tail = data + nblocks*16;
+
+  uint64_t k1 = 0;
+  uint64_t k2 = 0;
+
+  switch(len & 15)
+  {
+  case 15: k2 ^= ((uint64_t)(uint8_t)tail[14]) << 48; // fallthrough
+  case 14: k2 ^= ((uint64_t)(uint8_t)tail[13]) << 40; // fallthrough
+  case 13: k2 ^= ((uint64_t)(uint8_t)tail[12]) << 32; // fallthrough
+  case 12: k2 ^= ((uint64_t)(uint8_t)tail[11]) << 24; // fallthrough
+  case 11: k2 ^= ((uint64_t)(uint8_t)tail[10]) << 16; // fallthrough
+  case 10: k2 ^= ((uint64_t)(uint8_t)tail[ 9]) << 8; // fallthrough
+  case  9: k2 ^= ((uint64_t)(uint8_t)tail[ 8]) << 0;
+           k2 *= c2; k2  = murmur_rotl64(k2,33); k2 *= c1; h2 ^= k2;
+           // fallthrough
+
+  case  8: k1 ^= ((uint64_t)(uint8_t)tail[ 7]) << 56; // fallthrough
+  case  7: k1 ^= ((uint64_t)(uint8_t)tail[ 6]) << 48; // fallthrough
+  case  6: k1 ^= ((uint64_t)(uint8_t)tail[ 5]) << 40; // fallthrough
+  case  5: k1 ^= ((uint64_t)(uint8_t)tail[ 4]) << 32; // fallthrough
+  case  4: k1 ^= ((uint64_t)(uint8_t)tail[ 3]) << 24; // fallthrough
+  case  3: k1 ^= ((uint64_t)(uint8_t)tail[ 2]) << 16; // fallthrough
+  case  2: k1 ^= ((uint64_t)(uint8_t)tail[ 1]) << 8; // fallthrough
+  case  1: k1 ^= ((uint64_t)(uint8_t)tail[ 0]) << 0;
+           k1 *= c1; k1  = murmur_rotl64(k1,31); k1 *= c2; h1 ^= k1;
+  };
+
+  //----------
+  // finalization
+
+  h1 ^= len; h2 ^= len;
+
+  h1 += h2;
+  h2 += h1;
+
+  h1 = fmix64(h1);
+  h2 = fmix64(h2);
+
+  h1 += h2;
+  h2 += h1;
+
+  return MurmurHash128{h1, h2};
+}
+
+//-----------------------------------------------------------------------------
+// MurmurHash3_x86_32 and MurmurHash3_x64_128 of 4- and 8-byte integer keys,
+// equal to the hashes of their little-endian bytes but computed in registers,
+// without the block loop and the tail switch. The mix of a block word does
+// not depend on the seed, so that murmur_mix32 can be hoisted out of a loop
+// over seeds, leaving murmur_step32 and fmix32 per seed.
+
+constexpr uint32_t murmur_mix32 ( uint32_t k1 )
+{
+  k1 *= 0xcc9e2d51;
+  k1 = murmur_rotl32(k1,15);
+  return k1 * 0x1b873593;
+}
+
+constexpr uint32_t murmur_step32 ( uint32_t h1 )
+{
+  h1 = murmur_rotl32(h1,13);
+  return h1*5+0xe6546b64;
+}
+
+constexpr uint32_t MurmurHash3_x86_32_u32 ( uint32_t key, uint32_t seed )
+{
+  return fmix32(murmur_step32(seed ^ murmur_mix32(key)) ^ 4);
+}
+
+constexpr uint32_t MurmurHash3_x86_32_u64 ( uint64_t key, uint32_t seed )
+{
+  uint32_t h1 = murmur_step32(seed ^ murmur_mix32((uint32_t)key));
+  h1 = murmur_step32(h1 ^ murmur_mix32((uint32_t)(key >> 32)));
+  return fmix32(h1 ^ 8);
+}
+
+// Keys of up to 8 bytes are a single tail word k1 of MurmurHash3_x64_128.
+constexpr MurmurHash128 murmur_x64_128_k1 ( uint64_t k1, int len, uint32_t seed )
+{
+  uint64_t h1 = seed;
+  uint64_t h2 = seed;
+
+  k1 *= 0x87c37b91114253d5ULL; k1  = murmur_rotl64(k1,31); k1 *= 0x4cf5ad432745937fULL; h1 ^= k1;
+
+  h1 ^= len; h2 ^= len;
+
+  h1 += h2;
+  h2 += h1;
+
+  h1 = fmix64(h1);
+  h2 = fmix64(h2);
+
+  h1 += h2;
+  h2 += h1;
+
+  return MurmurHash128{h1, h2};
+}
+
+constexpr MurmurHash128 MurmurHash3_x64_128_u32 ( uint32_t key, uint32_t seed )
+{
+  return murmur_x64_128_k1(key, 4, seed);
+}
+
+constexpr MurmurHash128 MurmurHash3_x64_128_u64 ( uint64_t key, uint32_t seed )
+{
+  return murmur_x64_128_k1(key, 8, seed);
+}
+
+//-----------------------------------------------------------------------------
+// Incremental versions of MurmurHash3_x86_32 and MurmurHash3_x64_128, for
+// keys split across several buffers: init, then update with each piece in
+// order, then final returns the same hash as the contiguous key. The pieces
+// can have any length, a block split between two of them is buffered.
+
+struct MurmurHash3_x86_32_state
+{
+  uint32_t h1;
+  uint32_t tail; // Bytes of the partial block, the low (len & 3) ones
+  uint32_t len;
+};
+
+struct MurmurHash3_x64_128_state
+{
+  uint64_t h1;
+  uint64_t h2;
+  uint8_t tail[16]; // Bytes of the partial block, the first (len & 15) ones
+  uint32_t len;
+};
+
+void     MurmurHash3_x86_32_init   ( MurmurHash3_x86_32_state * state, uint32_t seed );
+void     MurmurHash3_x86_32_update ( MurmurHash3_x86_32_state * state, const void * key, int len );
+uint32_t MurmurHash3_x86_32_final  ( const MurmurHash3_x86_32_state * state );
+
+void          MurmurHash3_x64_128_init   ( MurmurHash3_x64_128_state * state, uint32_t seed );
+void          MurmurHash3_x64_128_update ( MurmurHash3_x64_128_state * state, const void * key, int len );
+MurmurHash128 MurmurHash3_x64_128_final  ( const MurmurHash3_x64_128_state * state );
+
 //-----------------------------------------------------------------------------
 
 #endif // _MURMURHASH3_H_
\ No newline at end of file
@@ -0,0 +1,739 @@
+/// Indexer maps an item onto the k bucket indices of a filter and maps a bucket
+/// index onto its collision region, according to the filter geometry and to
+/// the hash scheme. It holds no filter data, so that all the filter variants
+/// sharing the classic layout derive exactly the same bit positions.
+
+#ifndef _INDEXER_H_
+#define _INDEXER_H_
+
+#include "hash.h"
+#include "hash-engines.h"
+#include "hash-simd.h"
+
+#include <climits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#if __has_include(<span>)
+#include <span>
+#endif
+
+#include <sys/types.h>
+
+/// Largest number of keys hashed together by indicesBatch.
+#define INDEXER_LANES (16)
+
+/// Largest number of seeds of the seeded scheme hashed together by hash() and
+/// index().
+#define INDEXER_SEED_LANES (8)
+
+/// Schemes used to derive the k bucket indices of an item. The numeric values
+/// identify the scheme and must never change.
+enum HashScheme{
+    /// k calls to MurmurHash3_x86_32 with seeds 0..k-1, offset by the seed of
+    /// the filter. This is the original layout and the one existing filters
+    /// have been built with.
+    HASH_SCHEME_SEEDED = 0,
+    /// A single call to MurmurHash3_x64_128, with the k indices derived from
+    /// the two 64-bit halves by enhanced double hashing (Kirsch-Mitzenmacher,
+    /// Dillinger-Manolios).
+    HASH_SCHEME_DOUBLE = 1,
+    /// Enhanced double hashing on the engines of hash-engines.h.
+    HASH_SCHEME_WYHASH = 2,
+    HASH_SCHEME_CRC32C = 3,
+    HASH_SCHEME_XXH3 = 4,
+    /// Enhanced double hashing on SipHash-2-4, keyed with the seed of the
+    /// filter, for filters exposed to adversarial keys.
+    HASH_SCHEME_SIPHASH = 5
+};
+
+/// <summary>
+/// Returns whether this build supports the hash scheme.
+/// </summary>
+constexpr bool hashSchemeSupported(HashScheme hashScheme){
+    switch (hashScheme){
+    case HASH_SCHEME_SEEDED:
+    case HASH_SCHEME_DOUBLE:
+    case HASH_SCHEME_WYHASH:
+    case HASH_SCHEME_CRC32C:
+    case HASH_SCHEME_SIPHASH:
+        return true;
+#ifdef HASH_ENGINE_XXH3
+    case HASH_SCHEME_XXH3:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+/// <summary>
+/// Returns the name of a hash scheme, or NULL if it is unknown.
+/// </summary>
+inline const char* hashSchemeName(HashScheme hashScheme){
+    switch (hashScheme){
+    case HASH_SCHEME_SEEDED:
+        return "seeded";
+    case HASH_SCHEME_DOUBLE:
+        return "double";
+    case HASH_SCHEME_WYHASH:
+        return "wyhash";
+    case HASH_SCHEME_CRC32C:
+        return "crc32c";
+    case HASH_SCHEME_XXH3:
+        return "xxh3";
+    case HASH_SCHEME_SIPHASH:
+        return "siphash";
+    default:
+        return NULL;
+    }
+}
+
+/// Divisor computes the quotient and the remainder of values by a divisor
+/// known only at run time, without any integer division. Powers of two use a
+/// shift and a mask, any other divisor the multiply-shift reduction of Lemire,
+/// Kaser, Kurz (Faster Remainder by Direct Computation, 2019): a 64-bit
+/// multiplier is exact for 32-bit values, a 128-bit one for 64-bit values.
+class Divisor{
+private:
+    uint64_t d; /// The divisor
+    uint64_t M; /// ceil(2^64 / d), for 32-bit values
+    unsigned __int128 wideM; /// ceil(2^128 / d), for 64-bit values
+    uint shift; /// log2(d), for powers of two
+    bool pow2; /// Whether d is a power of two
+    bool wide; /// Whether the values can exceed 32 bits
+
+public:
+    /// <summary>
+    /// Creates a divisor for values up to maxValue.
+    /// </summary>
+    Divisor(uint64_t d = 1, uint64_t maxValue = UINT32_MAX) : d(d),
+            M(UINT64_MAX / d + 1), wideM(~(unsigned __int128) 0 / d + 1),
+            shift(__builtin_ctzll(d)), pow2((d & (d - 1)) == 0),
+            wide(maxValue > UINT32_MAX){}
+
+    /// <summary>
+    /// Returns a / d.
+    /// </summary>
+    uint64_t div(uint64_t a) const{
+        if (pow2){
+            return a >> shift;
+        }
+        if (!wide){
+            return ((unsigned __int128) M * (uint32_t) a) >> 64;
+        }
+        // High 64 bits of the 192-bit product wideM * a.
+        unsigned __int128 lo = ((unsigned __int128) (uint64_t) wideM * a) >> 64;
+        return ((unsigned __int128) (uint64_t) (wideM >> 64) * a + lo) >> 64;
+    }
+
+    /// <summary>
+    /// Returns a % d, for divisors lower than 2^32.
+    /// </summary>
+    uint32_t mod(uint32_t a) const{
+        if (pow2){
+            return a & (d - 1);
+        }
+        uint64_t lowbits = M * a;
+        return ((unsigned __int128) lowbits * d) >> 64;
+    }
+
+    /// <summary>
+    /// Returns the divisor.
+    /// </summary>
+    uint64_t get() const{
+        return d;
+    }
+};
+
+/// <summary>
+/// Returns the smallest power of two not lower than x.
+/// </summary>
+inline uint64_t nextPowerOfTwo(uint64_t x){
+    return x <= 1 ? 1 : (uint64_t) 1 << (64 - __builtin_clzll(x - 1));
+}
+
+/// Hashes of an item, computed by Indexer::hash() and from which
+/// Indexer::index() derives its bucket indices.
+struct ItemHash{
+    uint64_t h[2]; /// Hashes of the item, for the double hashing schemes
+    uint32_t seeded[INDEXER_SEED_LANES]; /// MurmurHash3_x86_32 of the item with seeds base.., for HASH_SCHEME_SEEDED
+    uint base; /// First seed hashed in seeded
+};
+
+/// <summary>
+/// Computes the two 64-bit hashes of the data with the engine of a double
+/// hashing scheme, seeded with seed.
+/// </summary>
+inline void hashEngine(HashScheme hashScheme, const char* data, int len, uint64_t seed, uint64_t* h){
+    switch (hashScheme){
+    case HASH_SCHEME_WYHASH:
+        WyhashEngine::hash(data, len, seed, h);
+        break;
+    case HASH_SCHEME_CRC32C:
+        Crc32cEngine::hash(data, len, seed, h);
+        break;
+#ifdef HASH_ENGINE_XXH3
+    case HASH_SCHEME_XXH3:
+        Xxh3Engine::hash(data, len, seed, h);
+        break;
+#endif
+    case HASH_SCHEME_SIPHASH:
+        SipEngine::hash(data, len, seed, h);
+        break;
+    default:
+        MurmurEngine::hash(data, len, seed, h);
+    }
+}
+
+/// <summary>
+/// Same as hashEngine, for a key split into n fragments.
+/// </summary>
+inline void hashEngine(HashScheme hashScheme, const KeyFragment* fragments, size_t n, uint64_t seed,
+                       uint64_t* h){
+    switch (hashScheme){
+    case HASH_SCHEME_WYHASH:
+        WyhashEngine::hash(fragments, n, seed, h);
+        break;
+    case HASH_SCHEME_CRC32C:
+        Crc32cEngine::hash(fragments, n, seed, h);
+        break;
+#ifdef HASH_ENGINE_XXH3
+    case HASH_SCHEME_XXH3:
+        Xxh3Engine::hash(fragments, n, seed, h);
+        break;
+#endif
+    case HASH_SCHEME_SIPHASH:
+        SipEngine::hash(fragments, n, seed, h);
+        break;
+    default:
+        MurmurEngine::hash(fragments, n, seed, h);
+    }
+}
+
+/// <summary>
+/// Same as MurmurHash3_x86_32_seeds, for a key split into n fragments: out[i]
+/// is the MurmurHash3_x86_32 of the whole key with seed + i. A single fragment
+/// goes to the SIMD kernel, several are hashed incrementally.
+/// </summary>
+inline void MurmurHash3_x86_32_seeds(const KeyFragment* fragments, size_t n, uint32_t seed,
+                                     uint32_t* out, size_t count){
+    if (n == 1){
+        MurmurHash3_x86_32_seeds(fragments[0].data, fragments[0].len, seed, out, count);
+        return;
+    }
+    for (size_t i = 0; i < count; i++){
+        MurmurHash3_x86_32_state state;
+        MurmurHash3_x86_32_init(&state, seed + i);
+        for (size_t j = 0; j < n; j++){
+            MurmurHash3_x86_32_update(&state, fragments[j].data, fragments[j].len);
+        }
+        out[i] = MurmurHash3_x86_32_final(&state);
+    }
+}
+
+/// <summary>
+/// Same as MurmurHash3_x86_32_seeds, for a 32-bit key: out[i] is the
+/// MurmurHash3_x86_32 of its 4 little-endian bytes with seed + i. The block is
+/// mixed once for all the seeds.
+/// </summary>
+inline void MurmurHash3_x86_32_seeds(uint32_t key, uint32_t seed, uint32_t* out, size_t count){
+    uint32_t k1 = murmur_mix32(key);
+    for (size_t i = 0; i < count; i++){
+        out[i] = fmix32(murmur_step32((seed + i) ^ k1) ^ 4);
+    }
+}
+
+/// <summary>
+/// Same as MurmurHash3_x86_32_seeds, for a 64-bit key hashed as its 8
+/// little-endian bytes.
+/// </summary>
+inline void MurmurHash3_x86_32_seeds(uint64_t key, uint32_t seed, uint32_t* out, size_t count){
+    uint32_t k1 = murmur_mix32((uint32_t) key);
+    uint32_t k2 = murmur_mix32((uint32_t) (key >> 32));
+    for (size_t i = 0; i < count; i++){
+        out[i] = fmix32(murmur_step32(murmur_step32((seed + i) ^ k1) ^ k2) ^ 8);
+    }
+}
+
+/// <summary>
+/// Same as hashEngine, for an integer key hashed as its little-endian bytes.
+/// MurmurHash3_x64_128 is computed in registers, the other engines are
+/// given the bytes of the key.
+/// </summary>
+template <typename Int>
+inline void hashEngine(HashScheme hashScheme, Int key, uint64_t seed, uint64_t* h){
+    static_assert(std::is_same<Int, uint32_t>::value || std::is_same<Int, uint64_t>::value,
+                  "Integer keys are uint32_t or uint64_t");
+    switch (hashScheme){
+    case HASH_SCHEME_SEEDED:
+    case HASH_SCHEME_DOUBLE:{
+        MurmurHash128 r = sizeof(Int) == 4 ? MurmurHash3_x64_128_u32(key, murmurSeed(seed))
+                                           : MurmurHash3_x64_128_u64(key, murmurSeed(seed));
+        h[0] = r.h1;
+        h[1] = r.h2;
+        break;
+    }
+    default:{
+        char data[sizeof(Int)];
+        for (size_t i = 0; i < sizeof(Int); i++){
+            data[i] = (char) (key >> (i * 8));
+        }
+        hashEngine(hashScheme, data, sizeof(Int), seed, h);
+    }
+    }
+}
+
+/// <summary>
+/// Returns the length of a key as the int length of the hash functions.
+/// Throws std::invalid_argument if the key is longer than INT_MAX bytes.
+/// </summary>
+inline int keyLength(size_t len){
+    if (len > INT_MAX){
+        throw std::invalid_argument("Key longer than INT_MAX bytes");
+    }
+    return (int) len;
+}
+
+/// Number of hashes a HashedKey of the seeded scheme holds by default, enough
+/// for false-positive rates down to 2^-16.
+#define HASHED_KEY_SEEDS (16)
+
+/// Largest number of hashes a HashedKey of the seeded scheme can hold.
+#define HASHED_KEY_MAX_SEEDS (32)
+
+/// HashedKey holds the hashes of an item under a hash scheme. It is computed
+/// once, possibly on another thread, and then passed to any number of filters
+/// using that scheme, whatever their size, without hashing the item again.
+/// The double hashing schemes only need their two 64-bit hashes, while the
+/// seeded scheme needs one hash per hash function of the filter: the key
+/// holds the hashes with seeds 0..seeds-1 and serves filters with up to seeds
+/// hash functions.
+class HashedKey{
+private:
+    HashScheme hashScheme; /// Scheme the key was hashed with
+    uint64_t seed; /// Seed of the filters the key serves
+    uint seeds; /// Number of hashes in seeded
+    uint64_t h[2]; /// Hashes of the item, for the double hashing schemes
+    uint32_t seeded[HASHED_KEY_MAX_SEEDS]; /// MurmurHash3_x86_32 of the item with seeds 0..seeds-1, for HASH_SCHEME_SEEDED
+
+public:
+    /// <summary>
+    /// Hashes the data. Throws std::invalid_argument if the scheme is not
+    /// supported by this build or if seeds exceeds HASHED_KEY_MAX_SEEDS. With
+    /// HASH_SCHEME_SEEDED and HASH_SCHEME_DOUBLE the key of a constant can be
+    /// computed at compile time:
+    ///
+    ///   constexpr HashedKey sentinel("sentinel", 8);
+    /// </summary>
+    /// <param name="data">The data to hash</param>
+    /// <param name="hashScheme">Scheme of the filters the key will be passed to</param>
+    /// <param name="seeds">Largest number of hash functions of those filters,
+    /// for the seeded scheme</param>
+    /// <param name="seed">Seed of those filters</param>
+    constexpr HashedKey(const char* data, int len, HashScheme hashScheme = HASH_SCHEME_SEEDED,
+                        uint seeds = HASHED_KEY_SEEDS, uint64_t seed = 0) :
+            hashScheme(hashScheme), seed(seed), seeds(0), h{}, seeded{}{
+        if (!hashSchemeSupported(hashScheme)){
+            throw std::invalid_argument("Hash scheme not supported by this build");
+        }
+        if (hashScheme == HASH_SCHEME_SEEDED){
+            if (seeds > HASHED_KEY_MAX_SEEDS){
+                throw std::invalid_argument("Too many seeds for a HashedKey");
+            }
+            this->seeds = seeds;
+            if (__builtin_is_constant_evaluated()){
+                for (uint i = 0; i < seeds; i++){
+                    seeded[i] = MurmurHash3_x86_32(data, len, murmurSeed(seed) + i);
+                }
+            }else{
+                MurmurHash3_x86_32_seeds(data, len, murmurSeed(seed), seeded, seeds);
+            }
+        }else if (__builtin_is_constant_evaluated() && hashScheme == HASH_SCHEME_DOUBLE){
+            MurmurHash128 r = MurmurHash3_x64_128(data, len, murmurSeed(seed));
+            h[0] = r.h1;
+            h[1] = r.h2;
+        }else{
+            hashEngine(hashScheme, data, len, seed, h);
+        }
+    }
+
+    /// <summary>
+    /// Hashes a key split into n fragments, with the same result as the
+    /// contiguous key. Throws std::invalid_argument as the constructor above.
+    /// </summary>
+    /// <param name="fragments">The fragments of the data, in order</param>
+    /// <param name="n">Number of fragments</param>
+    /// <param name="hashScheme">Scheme of the filters the key will be passed to</param>
+    /// <param name="seeds">Largest number of hash functions of those filters,
+    /// for the seeded scheme</param>
+    /// <param name="seed">Seed of those filters</param>
+    HashedKey(const KeyFragment* fragments, size_t n, HashScheme hashScheme = HASH_SCHEME_SEEDED,
+              uint seeds = HASHED_KEY_SEEDS, uint64_t seed = 0) :
+            hashScheme(hashScheme), seed(seed), seeds(0), h{}, seeded{}{
+        if (!hashSchemeSupported(hashScheme)){
+            throw std::invalid_argument("Hash scheme not supported by this build");
+        }
+        if (hashScheme == HASH_SCHEME_SEEDED){
+            if (seeds > HASHED_KEY_MAX_SEEDS){
+                throw std::invalid_argument("Too many seeds for a HashedKey");
+            }
+            this->seeds = seeds;
+            MurmurHash3_x86_32_seeds(fragments, n, murmurSeed(seed), seeded, seeds);
+        }else{
+            hashEngine(hashScheme, fragments, n, seed, h);
+        }
+    }
+
+    /// <summary>
+    /// Returns the scheme the key was hashed with.
+    /// </summary>
+    constexpr HashScheme getHashScheme() const{
+        return hashScheme;
+    }
+
+    /// <summary>
+    /// Returns the seed the key was hashed with.
+    /// </summary>
+    constexpr uint64_t getSeed() const{
+        return seed;
+    }
+
+    /// <summary>
+    /// Returns the number of hashes of the seeded scheme, 0 for the other
+    /// schemes.
+    /// </summary>
+    constexpr uint getSeeds() const{
+        return seeds;
+    }
+
+    /// <summary>
+    /// Returns the two 64-bit hashes of the double hashing schemes.
+    /// </summary>
+    constexpr const uint64_t* getHashes() const{
+        return h;
+    }
+
+    /// <summary>
+    /// Returns the hash with seed i of the seeded scheme.
+    /// </summary>
+    constexpr uint32_t getSeeded(uint i) const{
+        return seeded[i];
+    }
+};
+
+class Indexer{
+private:
+    uint64_t m; /// Filter size
+    Divisor buckets; /// Reduces hashes to bucket indices
+    Divisor regionSize; /// Divides bucket indices by the number of bits in a region
+    uint k; /// Number of hash functions
+    HashScheme hashScheme; /// Scheme used to derive the bucket indices
+    uint64_t seed; /// Seed of the hashes
+
+    /// Returns the i-th bucket index of the double hashing schemes.
+    uint64_t doubleIndex(const uint64_t* h, uint i) const{
+        // Enhanced double hashing: h1 + i*h2 + (i^3 - i)/6. The 64-bit result
+        // is mapped onto [0, m) with a multiply-shift (Lemire's fast range),
+        // which uses the high bits.
+        uint64_t x = h[0] + i * h[1] + ((uint64_t) i * i * i - i) / 6;
+        return ((unsigned __int128) x * m) >> 64;
+    }
+
+public:
+    /// <summary>
+    /// Creates an indexer for a filter of m buckets split into r collision
+    /// regions, using k hash functions seeded with seed. Throws
+    /// std::invalid_argument if the scheme is not supported by this build or
+    /// cannot address m buckets: the 32-bit hashes of the seeded scheme are
+    /// limited to 2^32 - 1 buckets.
+    /// </summary>
+    Indexer(uint64_t m = 1, uint64_t r = 1, uint k = 1, HashScheme hashScheme = HASH_SCHEME_SEEDED,
+            uint64_t seed = 0) :
+            m(m), buckets(m <= UINT32_MAX ? m : 1),
+            regionSize((m + r - 1) / r, m - 1), k(k), hashScheme(hashScheme), seed(seed){
+        // regionSize is rounded up, so that the last region index is r - 1.
+        if (!hashSchemeSupported(hashScheme)){
+            throw std::invalid_argument("Hash scheme not supported by this build");
+        }
+        if (hashScheme == HASH_SCHEME_SEEDED && m > UINT32_MAX){
+            throw std::invalid_argument("HASH_SCHEME_SEEDED supports at most 2^32 - 1 "
+                                        "buckets, use HASH_SCHEME_DOUBLE");
+        }
+    }
+
+    /// <summary>
+    /// Hashes the data. The double hashing schemes hash it once with their
+    /// engine, the seeded scheme hashes it with up to INDEXER_SEED_LANES seeds
+    /// at a time in the lanes of a SIMD register (hash-simd.h). The result is
+    /// then passed to index() to derive each of the k bucket indices.
+    /// </summary>
+    void hash(const char* data, int len, ItemHash& h) const{
+        if (hashScheme == HASH_SCHEME_SEEDED){
+            h.base = 0;
+            MurmurHash3_x86_32_seeds(data, len, murmurSeed(seed), h.seeded,
+                                     k < INDEXER_SEED_LANES ? k : INDEXER_SEED_LANES);
+        }else{
+            hashEngine(hashScheme, data, len, seed, h.h);
+        }
+    }
+
+    /// <summary>
+    /// Returns the i-th bucket index of the data, h being the result of hash().
+    /// </summary>
+    uint64_t index(const char* data, int len, ItemHash& h, uint i) const{
+        if (hashScheme != HASH_SCHEME_SEEDED){
+            return doubleIndex(h.h, i);
+        }
+        if (i - h.base >= INDEXER_SEED_LANES){
+            // Past the seeds hashed so far, with k > INDEXER_SEED_LANES.
+            h.base = i - i % INDEXER_SEED_LANES;
+            uint n = k - h.base < INDEXER_SEED_LANES ? k - h.base : INDEXER_SEED_LANES;
+            MurmurHash3_x86_32_seeds(data, len, murmurSeed(seed) + h.base, h.seeded, n);
+        }
+        // Same result as hash % m, on which the layout of the scheme is based.
+        return buckets.mod(h.seeded[i - h.base]);
+    }
+
+    /// <summary>
+    /// Same as hash(), for a key split into n fragments.
+    /// </summary>
+    void hash(const KeyFragment* fragments, size_t n, ItemHash& h) const{
+        if (hashScheme == HASH_SCHEME_SEEDED){
+            h.base = 0;
+            MurmurHash3_x86_32_seeds(fragments, n, murmurSeed(seed), h.seeded,
+                                     k < INDEXER_SEED_LANES ? k : INDEXER_SEED_LANES);
+        }else{
+            hashEngine(hashScheme, fragments, n, seed, h.h);
+        }
+    }
+
+    /// <summary>
+    /// Same as index(), for a key split into n fragments.
+    /// </summary>
+    uint64_t index(const KeyFragment* fragments, size_t n, ItemHash& h, uint i) const{
+        if (hashScheme != HASH_SCHEME_SEEDED){
+            return doubleIndex(h.h, i);
+        }
+        if (i - h.base >= INDEXER_SEED_LANES){
+            h.base = i - i % INDEXER_SEED_LANES;
+            uint count = k - h.base < INDEXER_SEED_LANES ? k - h.base : INDEXER_SEED_LANES;
+            MurmurHash3_x86_32_seeds(fragments, n, murmurSeed(seed) + h.base, h.seeded, count);
+        }
+        return buckets.mod(h.seeded[i - h.base]);
+    }
+
+    /// <summary>
+    /// Same as hash(), for a uint32_t or uint64_t key, with the same result as
+    /// its little-endian bytes. The seeded and double schemes hash it in
+    /// registers, without the block loop and the tail of the byte hashes.
+    /// </summary>
+    template <typename Int>
+    void hash(Int key, ItemHash& h) const{
+        if (hashScheme == HASH_SCHEME_SEEDED){
+            h.base = 0;
+            MurmurHash3_x86_32_seeds(key, murmurSeed(seed), h.seeded,
+                                     k < INDEXER_SEED_LANES ? k : INDEXER_SEED_LANES);
+        }else{
+            hashEngine(hashScheme, key, seed, h.h);
+        }
+    }
+
+    /// <summary>
+    /// Same as index(), for a uint32_t or uint64_t key.
+    /// </summary>
+    template <typename Int>
+    uint64_t index(Int key, ItemHash& h, uint i) const{
+        if (hashScheme != HASH_SCHEME_SEEDED){
+            return doubleIndex(h.h, i);
+        }
+        if (i - h.base >= INDEXER_SEED_LANES){
+            h.base = i - i % INDEXER_SEED_LANES;
+            uint n = k - h.base < INDEXER_SEED_LANES ? k - h.base : INDEXER_SEED_LANES;
+            MurmurHash3_x86_32_seeds(key, murmurSeed(seed) + h.base, h.seeded, n);
+        }
+        return buckets.mod(h.seeded[i - h.base]);
+    }
+
+    /// <summary>
+    /// Throws std::invalid_argument if the key cannot be used with this
+    /// indexer: it was hashed with another scheme or seed, or with fewer
+    /// seeds than hash functions.
+    /// </summary>
+    void check(const HashedKey& key) const{
+        if (key.getHashScheme() != hashScheme){
+            throw std::invalid_argument("HashedKey hashed with another hash scheme");
+        }
+        if (key.getSeed() != seed){
+            throw std::invalid_argument("HashedKey hashed with another seed");
+        }
+        if (hashScheme == HASH_SCHEME_SEEDED && key.getSeeds() < k){
+            throw std::invalid_argument("HashedKey has fewer seeds than hash functions");
+        }
+    }
+
+    /// <summary>
+    /// Returns the i-th bucket index of a key accepted by check().
+    /// </summary>
+    uint64_t index(const HashedKey& key, uint i) const{
+        if (hashScheme != HASH_SCHEME_SEEDED){
+            return doubleIndex(key.getHashes(), i);
+        }
+        return buckets.mod(key.getSeeded(i));
+    }
+
+    /// <summary>
+    /// Stores the k bucket indices of the data in idx.
+    /// </summary>
+    void indices(const char* data, int len, uint64_t* idx) const{
+        ItemHash h;
+        hash(data, len, h);
+        for (uint i = 0; i < k; i++){
+            idx[i] = index(data, len, h, i);
+        }
+    }
+
+    /// <summary>
+    /// Stores the k bucket indices of n keys in idx, k per key, with the same
+    /// result as indices(). Under the seeded scheme, consecutive keys of the
+    /// same length are hashed together by the SIMD kernels of hash-simd.h.
+    /// </summary>
+    template <typename Key>
+    void indicesBatch(const Key* keys, size_t n, uint64_t* idx) const{
+        const void* data[INDEXER_LANES];
+        uint32_t hashes[INDEXER_LANES];
+        size_t j = 0;
+        while (j < n){
+            size_t lanes = 1;
+            if (hashScheme == HASH_SCHEME_SEEDED){
+                while (j + lanes < n && lanes < INDEXER_LANES && keys[j + lanes].len == keys[j].len){
+                    lanes++;
+                }
+            }
+            if (lanes == 1){
+                indices(keys[j].data, keys[j].len, idx + j * k);
+                j++;
+                continue;
+            }
+            for (size_t l = 0; l < lanes; l++){
+                data[l] = keys[j + l].data;
+            }
+            for (uint i = 0; i < k; i++){
+                MurmurHash3_x86_32_keys(data, keys[j].len, murmurSeed(seed) + i, hashes, lanes);
+                for (size_t l = 0; l < lanes; l++){
+                    idx[(j + l) * k + i] = buckets.mod(hashes[l]);
+                }
+            }
+            j += lanes;
+        }
+    }
+
+    /// <summary>
+    /// Returns the collision region of a bucket index.
+    /// </summary>
+    uint64_t region(uint64_t index) const{
+        return regionSize.div(index);
+    }
+
+    /// <summary>
+    /// Returns the number of buckets.
+    /// </summary>
+    uint64_t getM() const{
+        return m;
+    }
+
+    /// <summary>
+    /// Returns the number of bits in a region.
+    /// </summary>
+    uint64_t getRegionSize() const{
+        return regionSize.get();
+    }
+
+    /// <summary>
+    /// Returns the number of hash functions.
+    /// </summary>
+    uint getK() const{
+        return k;
+    }
+
+    /// <summary>
+    /// Returns the scheme used to derive the bucket indices.
+    /// </summary>
+    HashScheme getHashScheme() const{
+        return hashScheme;
+    }
+
+    /// <summary>
+    /// Returns the seed of the hashes.
+    /// </summary>
+    uint64_t getSeed() const{
+        return seed;
+    }
+};
+
+/// RawItem is an item given by its bytes, hashed on construction. The filter
+/// operations are written once for RawItem, FragmentItem, IntItem and HashedKey,
+/// through itemIndex().
+struct RawItem{
+    const char* data; /// Item data
+    int len; /// Length of the data
+    ItemHash h; /// Hashes computed so far
+
+    RawItem(const Indexer& indexer, const char* data, int len) : data(data), len(len){
+        indexer.hash(data, len, h);
+    }
+};
+
+/// FragmentItem is an item split into fragments, hashed on construction.
+struct FragmentItem{
+    const KeyFragment* fragments; /// Item fragments
+    size_t n; /// Number of fragments
+    ItemHash h; /// Hashes computed so far
+
+    FragmentItem(const Indexer& indexer, const KeyFragment* fragments, size_t n) : fragments(fragments), n(n){
+        indexer.hash(fragments, n, h);
+    }
+};
+
+/// IntItem is a uint32_t or uint64_t item, hashed on construction as its
+/// little-endian bytes.
+template <typename Int>
+struct IntItem{
+    Int key; /// Item
+    ItemHash h; /// Hashes computed so far
+
+    IntItem(const Indexer& indexer, Int key) : key(key){
+        indexer.hash(key, h);
+    }
+};
+
+/// <summary>
+/// Returns the i-th bucket index of a HashedKey.
+/// </summary>
+inline uint64_t itemIndex(const Indexer& indexer, const HashedKey& key, uint i){
+    return indexer.index(key, i);
+}
+
+/// <summary>
+/// Returns the i-th bucket index of a RawItem.
+/// </summary>
+inline uint64_t itemIndex(const Indexer& indexer, RawItem& item, uint i){
+    return indexer.index(item.data, item.len, item.h, i);
+}
+
+/// <summary>
+/// Returns the i-th bucket index of a FragmentItem.
+/// </summary>
+inline uint64_t itemIndex(const Indexer& indexer, FragmentItem& item, uint i){
+    return indexer.index(item.fragments, item.n, item.h, i);
+}
+
+/// <summary>
+/// Returns the i-th bucket index of an IntItem.
+/// </summary>
+template <typename Int>
+inline uint64_t itemIndex(const Indexer& indexer, IntItem<Int>& item, uint i){
+    return indexer.index(item.key, item.h, i);
+}
+
+#endif // _INDEXER_H_
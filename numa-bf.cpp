@@ -0,0 +1,369 @@
+/// NumaDeletableBloomFilter is a ConcurrentDeletableBloomFilter replicated on
+/// every NUMA node, see numa-bf.h.
+
+#include "numa-bf.h"
+
+#include <stdexcept>
+
+#include <sched.h>
+
+#ifdef DBF_HAVE_NUMA
+#include <numa.h>
+#endif
+
+NumaDeletableBloomFilter::NumaDeletableBloomFilter(uint64_t n, uint64_t r, double fpRate,
+                                                   HashScheme hashScheme, bool powerOfTwo,
+                                                   uint64_t seed, uint replicas) :
+        collisions(r){
+    uint64_t optM = DeletableBloomFilter::optimalM(n, fpRate);
+    uint64_t m = powerOfTwo ? nextPowerOfTwo(optM - r) : optM - r;
+    indexer = Indexer(m, r, DeletableBloomFilter::optimalK(fpRate), hashScheme, seed);
+    allocateReplicas(m, replicas);
+}
+
+void NumaDeletableBloomFilter::allocateReplicas(uint64_t m, uint numReplicas){
+    numWords = (m + 63) / 64;
+    // The destructor does not run if the constructor throws, so the replicas
+    // allocated before a failure are freed here.
+    try{
+#ifdef DBF_HAVE_NUMA
+        if (numa_available() >= 0){
+            size_t bytes = numWords * sizeof(std::atomic<uint64_t>);
+            std::vector<int> nodes;
+            for (int node = 0; node <= numa_max_node(); node++){
+                if (numa_bitmask_isbitset(numa_all_nodes_ptr, node)){
+                    nodes.push_back(node);
+                }
+            }
+            // One replica per node with memory by default, otherwise the
+            // replicas are spread over the nodes round-robin. The pages are
+            // bound to the node before being touched, so the zeroing below
+            // faults them in there.
+            std::vector<int> nodeReplica(numa_max_node() + 1, -1);
+            replicas.reserve(numReplicas ? numReplicas : nodes.size());
+            for (size_t i = 0; i < (numReplicas ? numReplicas : nodes.size()); i++){
+                int node = nodes[i % nodes.size()];
+                void* words = numa_alloc_onnode(bytes, node);
+                if (!words){
+                    throw std::bad_alloc();
+                }
+                if (nodeReplica[node] < 0){
+                    nodeReplica[node] = replicas.size();
+                }
+                replicas.push_back({(std::atomic<uint64_t>*) words, node});
+            }
+            // CPUs read the first replica of their node, or the first replica
+            // if their node has none.
+            cpuReplica.resize(numa_num_configured_cpus(), 0);
+            for (size_t cpu = 0; cpu < cpuReplica.size(); cpu++){
+                int node = numa_node_of_cpu(cpu);
+                if (node >= 0 && nodeReplica[node] >= 0){
+                    cpuReplica[cpu] = nodeReplica[node];
+                }
+            }
+        }
+#endif
+        replicas.reserve(numReplicas ? numReplicas : 1);
+        while (replicas.size() < (numReplicas ? numReplicas : 1)){
+            replicas.push_back({(std::atomic<uint64_t>*) allocateWords(m, sizeof(std::atomic<uint64_t>)), -1});
+        }
+    }catch (...){
+        freeReplicas();
+        throw;
+    }
+    for (Replica& replica : replicas){
+        for (size_t i = 0; i < numWords; i++){
+            new (&replica.words[i]) std::atomic<uint64_t>(0);
+        }
+    }
+}
+
+void NumaDeletableBloomFilter::freeReplicas(){
+    for (Replica& replica : replicas){
+#ifdef DBF_HAVE_NUMA
+        if (replica.node >= 0){
+            numa_free(replica.words, numWords * sizeof(std::atomic<uint64_t>));
+            continue;
+        }
+#endif
+        free(replica.words);
+    }
+    replicas.clear();
+}
+
+NumaDeletableBloomFilter::~NumaDeletableBloomFilter(){
+    freeReplicas();
+}
+
+/// <summary>
+/// Pins the calling thread to the CPUs of a node, so that its lookups keep
+/// reading the same replica. Returns false if the thread could not be
+/// pinned, always in builds without libnuma.
+/// </summary>
+/// <param name="node">The node to run on</param>
+/// <returns>Whether the thread was pinned</returns>
+bool NumaDeletableBloomFilter::runOnNode(int node){
+#ifdef DBF_HAVE_NUMA
+    return numa_available() >= 0 && numa_run_on_node(node) == 0;
+#else
+    (void) node;
+    return false;
+#endif
+}
+
+inline uint NumaDeletableBloomFilter::localReplica(){
+    // sched_getcpu is served by the vDSO, without a system call.
+    int cpu = sched_getcpu();
+    return cpu >= 0 && (size_t) cpu < cpuReplica.size() ? cpuReplica[cpu] : 0;
+}
+
+inline bool NumaDeletableBloomFilter::ReplicaBuckets::testAndSet(uint64_t hash){
+    uint64_t mask = (uint64_t) 1 << (hash % 64);
+    // The first replica is set first and cleared last. If its bucket was
+    // clear, any removal that cleared it had already cleared the other
+    // replicas, so the fetch_or below are applied after its fetch_and.
+    bool set = replicas[0].words[hash / 64].fetch_or(mask) & mask;
+    for (size_t i = 1; i < replicas.size(); i++){
+        replicas[i].words[hash / 64].fetch_or(mask);
+    }
+    return set;
+}
+
+inline void NumaDeletableBloomFilter::ReplicaBuckets::clear(uint64_t hash){
+    uint64_t mask = (uint64_t) 1 << (hash % 64);
+    for (size_t i = replicas.size(); i-- > 0;){
+        replicas[i].words[hash / 64].fetch_and(~mask);
+    }
+}
+
+/// <summary>
+/// Returns the number of replicas of the buckets.
+/// </summary>
+/// <returns>The number of replicas</returns>
+uint NumaDeletableBloomFilter::getReplicas(){
+    return replicas.size();
+}
+
+/// <summary>
+/// Returns the node a replica is allocated on, -1 if it was not allocated
+/// on a specific node.
+/// </summary>
+/// <param name="replica">The replica, lower than getReplicas()</param>
+/// <returns>The node of the replica</returns>
+int NumaDeletableBloomFilter::getReplicaNode(uint replica){
+    return replicas.at(replica).node;
+}
+
+/// <summary>
+/// Returns the number of items added to the filter.
+/// </summary>
+/// <returns>The number of items added to the filter</returns>
+uint64_t NumaDeletableBloomFilter::getCount(){
+    return count.get();
+}
+
+/// <summary>
+/// Returns the seed of the hashes, to build another filter with the same
+/// bucket indices.
+/// </summary>
+/// <returns>The seed of the filter</returns>
+uint64_t NumaDeletableBloomFilter::getSeed(){
+    return indexer.getSeed();
+}
+
+template <typename Item>
+inline bool NumaDeletableBloomFilter::testItem(Item& item, uint replica){
+    const std::atomic<uint64_t>* words = replicas[replica].words;
+    uint k = indexer.getK();
+    // If any of the K bits are not set, then it's not a member.
+    for (uint i = 0; i < k; i++){
+        uint64_t hash = itemIndex(indexer, item, i);
+        if (!((words[hash / 64].load(std::memory_order_relaxed) >> (hash % 64)) & 1)){
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Item>
+inline bool NumaDeletableBloomFilter::testAndAddItem(Item& item){
+    ReplicaBuckets buckets{replicas};
+    bool member = true;
+    uint k = indexer.getK();
+    for (uint i = 0; i < k; i++){
+        if (!concurrentSetBucket(buckets, collisions, indexer, itemIndex(indexer, item, i))){
+            member = false;
+        }
+    }
+    count.add(1);
+    return member;
+}
+
+template <typename Item>
+inline bool NumaDeletableBloomFilter::testAndRemoveItem(Item& item){
+    if (!testItem(item, 0)){
+        return false;
+    }
+    ReplicaBuckets buckets{replicas};
+    uint k = indexer.getK();
+    for (uint i = 0; i < k; i++){
+        // Clear only bits located in collision-free zones.
+        concurrentClearBucket(buckets, collisions, indexer, itemIndex(indexer, item, i));
+    }
+    count.add(-1);
+    return true;
+}
+
+/// <summary>
+/// Will test for membership of the data in the replica of the node of the
+/// calling thread, and returns true if it is a member, false if not.
+/// </summary>
+/// <param name="data">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool NumaDeletableBloomFilter::test(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testItem(item, localReplica());
+}
+
+/// <summary>
+/// Same as Test, reading the given replica whatever the node of the
+/// calling thread. Throws std::out_of_range if there is no such replica.
+/// </summary>
+/// <param name="replica">The replica to read</param>
+/// <param name="data">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool NumaDeletableBloomFilter::testReplica(uint replica, const char* data, int len){
+    if (replica >= replicas.size()){
+        throw std::out_of_range("No such replica");
+    }
+    RawItem item(indexer, data, len);
+    return testItem(item, replica);
+}
+
+/// <summary>
+/// Will add the data to every replica of the filter.
+/// </summary>
+/// <param name="data">The data to add.</param>
+void NumaDeletableBloomFilter::add(const char* data, int len){
+    RawItem item(indexer, data, len);
+    testAndAddItem(item);
+}
+
+/// <summary>
+/// Is equivalent to calling Test followed by Add. It returns true if the data is
+/// a member, false if not.
+/// </summary>
+/// <param name="data">The data to test for and add if it doesn't exist.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool NumaDeletableBloomFilter::testAndAdd(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testAndAddItem(item);
+}
+
+/// <summary>
+/// Will test for membership of the data and remove it from every replica
+/// of the filter if it exists. Returns true if the data was a member,
+/// false if not.
+/// </summary>
+/// <param name="data">The data to test for and remove</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool NumaDeletableBloomFilter::testAndRemove(const char* data, int len){
+    RawItem item(indexer, data, len);
+    return testAndRemoveItem(item);
+}
+
+/// <summary>
+/// Same as Test, for a key hashed beforehand. Throws std::invalid_argument
+/// if the key cannot be used with the filter, see DeletableBloomFilter.
+/// </summary>
+/// <param name="key">The hashed data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool NumaDeletableBloomFilter::test(const HashedKey& key){
+    indexer.check(key);
+    return testItem(key, localReplica());
+}
+
+/// <summary>
+/// Same as Add, for a key hashed beforehand. Throws std::invalid_argument as
+/// Test does.
+/// </summary>
+/// <param name="key">The hashed data to add.</param>
+void NumaDeletableBloomFilter::add(const HashedKey& key){
+    indexer.check(key);
+    testAndAddItem(key);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key hashed beforehand. Throws
+/// std::invalid_argument as Test does.
+/// </summary>
+/// <param name="key">The hashed data to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool NumaDeletableBloomFilter::testAndAdd(const HashedKey& key){
+    indexer.check(key);
+    return testAndAddItem(key);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key hashed beforehand. Throws
+/// std::invalid_argument as Test does.
+/// </summary>
+/// <param name="key">The hashed data to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool NumaDeletableBloomFilter::testAndRemove(const HashedKey& key){
+    indexer.check(key);
+    return testAndRemoveItem(key);
+}
+
+/// <summary>
+/// Same as Test, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool NumaDeletableBloomFilter::test(std::string_view key){
+    return test(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as Add, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to add.</param>
+void NumaDeletableBloomFilter::add(std::string_view key){
+    add(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool NumaDeletableBloomFilter::testAndAdd(std::string_view key){
+    return testAndAdd(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool NumaDeletableBloomFilter::testAndRemove(std::string_view key){
+    return testAndRemove(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Restores the Bloom filter to its original state. Must not run
+/// concurrently with any other operation.
+/// </summary>
+void NumaDeletableBloomFilter::reset(){
+    for (Replica& replica : replicas){
+        for (size_t i = 0; i < numWords; i++){
+            replica.words[i].store(0, std::memory_order_relaxed);
+        }
+    }
+    collisions.reset();
+    count.reset();
+}
@@ -0,0 +1,250 @@
+/// NumaDeletableBloomFilter is a ConcurrentDeletableBloomFilter whose buckets
+/// are replicated on every NUMA node, so that the lookups of a thread read the
+/// copy in the memory of its own node instead of crossing the interconnect.
+///
+/// Every replica is allocated on its node with libnuma. The updates are applied
+/// to all the replicas with the atomic operations of the
+/// ConcurrentDeletableBloomFilter, and have the same semantics under
+/// concurrency once they have returned: an item whose Add has returned is
+/// reported as a member by every Test that starts afterwards, on any node. The
+/// first replica is the reference of the updates: Add detects the collisions
+/// and TestAndRemove the membership on it. Add sets it before the other
+/// replicas and TestAndRemove clears it after them, so that once a racing Add
+/// and TestAndRemove have both returned, every replica holds the same buckets.
+/// A Test running concurrently with them may read replicas that briefly differ.
+/// The collision regions and the count are not replicated, as only the updates
+/// read them.
+///
+/// Test reads the replica of the node of the CPU the calling thread runs on.
+/// Builds without libnuma, and hosts where it reports no NUMA support, keep a
+/// single replica unless more are requested.
+
+#ifndef _NUMA_BF_H_
+#define _NUMA_BF_H_
+
+#include "bitset.h"
+#include "concurrent-bf.h"
+#include "del-bf.h"
+#include "indexer.h"
+
+#include <atomic>
+#include <vector>
+
+class NumaDeletableBloomFilter{
+private:
+    /// A copy of the buckets, allocated on a node.
+    struct Replica{
+        std::atomic<uint64_t>* words; /// Bucket data
+        int node; /// Node the words are allocated on
+    };
+
+    std::vector<Replica> replicas; /// Copies of the buckets, the first one being the reference
+    std::vector<uint> cpuReplica; /// Replica read by each CPU
+    size_t numWords; /// Number of words of a replica
+    AtomicBitset collisions; /// Filter collision data
+    Indexer indexer; /// Maps items onto buckets and buckets onto regions
+    ConcurrentCount count; /// Number of items in the filter
+
+    /// Allocates numReplicas replicas, or one per node with memory if 0, spread
+    /// over the nodes if NUMA is supported.
+    void allocateReplicas(uint64_t m, uint numReplicas);
+
+    /// Frees the replicas.
+    void freeReplicas();
+
+    /// Returns the replica of the node of the calling thread.
+    uint localReplica();
+
+    /// The replicas of the buckets, updated as the buckets of a
+    /// ConcurrentDeletableBloomFilter by concurrentSetBucket and
+    /// concurrentClearBucket. The first replica is set before the others and
+    /// cleared after them.
+    struct ReplicaBuckets{
+        std::vector<Replica>& replicas;
+
+        /// Sets a bucket in every replica, returns whether it was set in the
+        /// first one.
+        bool testAndSet(uint64_t hash);
+
+        /// Clears a bucket in every replica.
+        void clear(uint64_t hash);
+    };
+
+    /// Operations on a RawItem or a HashedKey.
+    template <typename Item> bool testItem(Item& item, uint replica);
+    template <typename Item> bool testAndAddItem(Item& item);
+    template <typename Item> bool testAndRemoveItem(Item& item);
+
+public:
+    /// <summary>
+    /// Creates a new NumaDeletableBloomFilter optimized to store n items with a
+    /// specified target false-positive rate, see DeletableBloomFilter. Its
+    /// bucket indices are those of the DeletableBloomFilter built with the same
+    /// parameters.
+    /// </summary>
+    /// <param name="n">Number of items</param>
+    /// <param name="r">Number of bits to use to store collision information</param>
+    /// <param name="fpRate">Desired false positive rate</param>
+    /// <param name="hashScheme">Scheme used to derive the bucket indices</param>
+    /// <param name="powerOfTwo">Whether to round the number of buckets up to a
+    /// power of two, see DeletableBloomFilter</param>
+    /// <param name="seed">Seed of the hashes, see DeletableBloomFilter</param>
+    /// <param name="replicas">Number of replicas, 0 for one per node with
+    /// memory. The replicas are assigned to the nodes round-robin, so several
+    /// replicas can share a node, e.g. to test a host with a single node.</param>
+    NumaDeletableBloomFilter(uint64_t n, uint64_t r, double fpRate,
+                             HashScheme hashScheme = HASH_SCHEME_SEEDED,
+                             bool powerOfTwo = false, uint64_t seed = 0,
+                             uint replicas = 0);
+
+    NumaDeletableBloomFilter(const NumaDeletableBloomFilter&) = delete;
+    NumaDeletableBloomFilter& operator=(const NumaDeletableBloomFilter&) = delete;
+
+    ~NumaDeletableBloomFilter();
+
+    /// <summary>
+    /// Pins the calling thread to the CPUs of a node, so that its lookups keep
+    /// reading the same replica. Returns false if the thread could not be
+    /// pinned, always in builds without libnuma.
+    /// </summary>
+    /// <param name="node">The node to run on</param>
+    /// <returns>Whether the thread was pinned</returns>
+    static bool runOnNode(int node);
+
+    /// <summary>
+    /// Returns the number of replicas of the buckets.
+    /// </summary>
+    /// <returns>The number of replicas</returns>
+    uint getReplicas();
+
+    /// <summary>
+    /// Returns the node a replica is allocated on, -1 if it was not allocated
+    /// on a specific node.
+    /// </summary>
+    /// <param name="replica">The replica, lower than getReplicas()</param>
+    /// <returns>The node of the replica</returns>
+    int getReplicaNode(uint replica);
+
+    /// <summary>
+    /// Returns the number of items added to the filter.
+    /// </summary>
+    /// <returns>The number of items added to the filter</returns>
+    uint64_t getCount();
+
+    /// <summary>
+    /// Returns the seed of the hashes, to build another filter with the same
+    /// bucket indices.
+    /// </summary>
+    /// <returns>The seed of the filter</returns>
+    uint64_t getSeed();
+
+    /// <summary>
+    /// Will test for membership of the data in the replica of the node of the
+    /// calling thread, and returns true if it is a member, false if not.
+    /// </summary>
+    /// <param name="data">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const char* data, int len);
+
+    /// <summary>
+    /// Same as Test, reading the given replica whatever the node of the
+    /// calling thread. Throws std::out_of_range if there is no such replica.
+    /// </summary>
+    /// <param name="replica">The replica to read</param>
+    /// <param name="data">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool testReplica(uint replica, const char* data, int len);
+
+    /// <summary>
+    /// Will add the data to every replica of the filter.
+    /// </summary>
+    /// <param name="data">The data to add.</param>
+    void add(const char* data, int len);
+
+    /// <summary>
+    /// Is equivalent to calling Test followed by Add. It returns true if the data is
+    /// a member, false if not.
+    /// </summary>
+    /// <param name="data">The data to test for and add if it doesn't exist.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const char* data, int len);
+
+    /// <summary>
+    /// Will test for membership of the data and remove it from every replica
+    /// of the filter if it exists. Returns true if the data was a member,
+    /// false if not.
+    /// </summary>
+    /// <param name="data">The data to test for and remove</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const char* data, int len);
+
+    /// <summary>
+    /// Same as Test, for a key hashed beforehand. Throws std::invalid_argument
+    /// if the key cannot be used with the filter, see DeletableBloomFilter.
+    /// </summary>
+    /// <param name="key">The hashed data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const HashedKey& key);
+
+    /// <summary>
+    /// Same as Add, for a key hashed beforehand. Throws std::invalid_argument as
+    /// Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to add.</param>
+    void add(const HashedKey& key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key hashed beforehand. Throws
+    /// std::invalid_argument as Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const HashedKey& key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key hashed beforehand. Throws
+    /// std::invalid_argument as Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const HashedKey& key);
+
+    /// <summary>
+    /// Same as Test, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(std::string_view key);
+
+    /// <summary>
+    /// Same as Add, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to add.</param>
+    void add(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(std::string_view key);
+
+    /// <summary>
+    /// Restores the Bloom filter to its original state. Must not run
+    /// concurrently with any other operation.
+    /// </summary>
+    void reset();
+};
+
+#endif // _NUMA_BF_H_
@@ -0,0 +1,167 @@
+/// Measures how evenly each hash scheme spreads items over a filter, with
+/// realistic and adversarial key sets, and prints one CSV row per scheme and
+/// key set:
+///
+///   bucket_z, region_z  uniformity of the number of probes per bucket and
+///                       per collision region: the chi-square statistic against
+///                       a uniform spread, as a z-score (|z| of a few is noise,
+///                       tens or more mean a skewed index derivation)
+///   fpr, fpr_ratio      false-positive rate of the full filter on keys of the
+///                       same set that were not added, and its ratio to fpRate
+///   expected_fpr        (1 - e^(-kn/m))^k, the rate of uniform probes with the
+///                       actual m and k, which the sizing sets above fpRate
+///   collided            fraction of the collision regions marked as collided,
+///                       and the one expected from uniform probes
+///
+/// The occupancy columns are NA for the blocked layout, whose positions are
+/// internal to the filter.
+///
+/// Usage: quality [items] [r] [fpRate]
+
+#include "blocked-bf.h"
+#include "del-bf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define PROBES (200000)
+
+/// Longest key built by makeKey.
+#define MAX_KEY (64)
+
+enum KeySet{SEQ32, SEQ64, STRIDED, SHORT, PREFIX};
+
+static const char* keySetNames[] = {"seq32", "seq64", "strided", "short", "prefix"};
+
+/// Writes the i-th key of a set to buf and returns its length.
+static int makeKey(KeySet set, uint64_t i, char* buf){
+    switch (set){
+    case SEQ32:{
+        // Sequential integers.
+        uint32_t x = i;
+        memcpy(buf, &x, sizeof(x));
+        return sizeof(x);
+    }
+    case SEQ64:
+        memcpy(buf, &i, sizeof(i));
+        return sizeof(i);
+    case STRIDED:{
+        // Only the high bits vary, as with shifted IDs or aligned addresses.
+        uint64_t x = i << 32;
+        memcpy(buf, &x, sizeof(x));
+        return sizeof(x);
+    }
+    case SHORT:
+        // Short decimal strings.
+        return snprintf(buf, MAX_KEY, "%lu", (unsigned long) i);
+    default:
+        // A long common prefix, as with composite keys.
+        return snprintf(buf, MAX_KEY, "tenant-0042/user-000017/object/%lu", (unsigned long) i);
+    }
+}
+
+/// Returns the chi-square statistic of the counts against expected counts
+/// proportional to the sizes, as a z-score.
+static double chiSquareZ(const std::vector<uint32_t>& counts, const std::vector<double>& expected){
+    double chi2 = 0;
+    for (size_t i = 0; i < counts.size(); i++){
+        double d = counts[i] - expected[i];
+        chi2 += d * d / expected[i];
+    }
+    double df = counts.size() - 1;
+    return (chi2 - df) / std::sqrt(2 * df);
+}
+
+/// Returns the false-positive rate of the filter on the keys n..n+PROBES-1.
+template <typename Filter>
+static double falsePositiveRate(Filter& filter, KeySet set, uint64_t n){
+    char key[MAX_KEY];
+    uint64_t fp = 0;
+    for (uint64_t i = n; i < n + PROBES; i++){
+        int len = makeKey(set, i, key);
+        fp += filter.test(key, len);
+    }
+    return (double) fp / PROBES;
+}
+
+static void classic(const char* name, HashScheme hashScheme, bool powerOfTwo, KeySet set,
+                    uint64_t n, uint64_t r, double fpRate){
+    DeletableBloomFilter dbf(n, r, fpRate, hashScheme, powerOfTwo);
+    const Indexer& indexer = dbf.getIndexer();
+    uint64_t m = indexer.getM();
+    uint k = indexer.getK();
+    uint64_t regionSize = indexer.getRegionSize();
+    // The region size is rounded up, trailing regions may have no bucket.
+    uint64_t numRegions = (m + regionSize - 1) / regionSize;
+
+    std::vector<uint32_t> buckets(m), regions(numRegions);
+    std::vector<uint64_t> idx(k);
+    char key[MAX_KEY];
+    for (uint64_t i = 0; i < n; i++){
+        int len = makeKey(set, i, key);
+        dbf.add(key, len);
+        indexer.indices(key, len, idx.data());
+        for (uint j = 0; j < k; j++){
+            buckets[idx[j]]++;
+            regions[indexer.region(idx[j])]++;
+        }
+    }
+
+    // Every bucket, and every region in proportion to its size, should get
+    // the same share of the n * k probes.
+    double probes = (double) n * k;
+    std::vector<double> bucketExpected(m, probes / m), regionExpected(numRegions);
+    for (uint64_t i = 0; i < numRegions; i++){
+        regionExpected[i] = probes * (std::min((i + 1) * regionSize, m) - i * regionSize) / m;
+    }
+
+    // A region is collided as soon as one of its buckets gets two probes.
+    double lambda = probes / m;
+    double expectedCollided = 1 - std::pow(std::exp(-lambda) * (1 + lambda), (double) regionSize);
+
+    double fpr = falsePositiveRate(dbf, set, n);
+    printf("%s,%s,%lu,%lu,%u,%.4f,%.4f,%g,%.6f,%.3f,%.6f,%.4f,%.4f\n", name, keySetNames[set],
+           (unsigned long) n, (unsigned long) m, k, chiSquareZ(buckets, bucketExpected),
+           chiSquareZ(regions, regionExpected), fpRate, fpr, fpr / fpRate,
+           std::pow(1 - std::exp(-lambda), (double) k),
+           (double) dbf.getCollidedRegions() / numRegions, expectedCollided);
+}
+
+static void blocked(KeySet set, uint64_t n, uint64_t r, double fpRate){
+    BlockedDeletableBloomFilter dbf(n, r, fpRate);
+    char key[MAX_KEY];
+    for (uint64_t i = 0; i < n; i++){
+        int len = makeKey(set, i, key);
+        dbf.add(key, len);
+    }
+    double fpr = falsePositiveRate(dbf, set, n);
+    printf("blocked,%s,%lu,NA,%u,NA,NA,%g,%.6f,%.3f,NA,%.4f,NA\n", keySetNames[set], (unsigned long) n,
+           DeletableBloomFilter::optimalK(fpRate), fpRate, fpr, fpr / fpRate,
+           (double) dbf.getCollidedRegions() / dbf.getRegions());
+}
+
+int main(int argc, char** argv){
+    uint64_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000;
+    uint64_t r = argc > 2 ? strtoull(argv[2], NULL, 10) : n / 2;
+    double fpRate = argc > 3 ? atof(argv[3]) : 0.01;
+
+    printf("filter,keys,items,m,k,bucket_z,region_z,target,fpr,fpr_ratio,expected_fpr,collided,expected_collided\n");
+    for (KeySet set : {SEQ32, SEQ64, STRIDED, SHORT, PREFIX}){
+        classic("seeded", HASH_SCHEME_SEEDED, false, set, n, r, fpRate);
+        classic("seeded-pow2", HASH_SCHEME_SEEDED, true, set, n, r, fpRate);
+        classic("double", HASH_SCHEME_DOUBLE, false, set, n, r, fpRate);
+        classic("double-pow2", HASH_SCHEME_DOUBLE, true, set, n, r, fpRate);
+        classic("wyhash", HASH_SCHEME_WYHASH, false, set, n, r, fpRate);
+        classic("crc32c", HASH_SCHEME_CRC32C, false, set, n, r, fpRate);
+        classic("siphash", HASH_SCHEME_SIPHASH, false, set, n, r, fpRate);
+        if (hashSchemeSupported(HASH_SCHEME_XXH3)){
+            classic("xxh3", HASH_SCHEME_XXH3, false, set, n, r, fpRate);
+        }
+        blocked(set, n, r, fpRate);
+        fflush(stdout);
+    }
+}
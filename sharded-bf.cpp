@@ -0,0 +1,314 @@
+/// ShardedDeletableBloomFilter is a DeletableBloomFilter split into shards
+/// with a lock each, see sharded-bf.h for the routing of the keys.
+
+#include "sharded-bf.h"
+
+#include <algorithm>
+
+ShardedDeletableBloomFilter::ShardedDeletableBloomFilter(uint64_t n, uint64_t r, double fpRate, uint shards,
+                                                         HashScheme hashScheme, bool powerOfTwo,
+                                                         uint64_t seed) :
+        hashScheme(hashScheme), seed(seed), k(DeletableBloomFilter::optimalK(fpRate)){
+    if (shards == 0){
+        throw std::invalid_argument("A sharded filter needs at least one shard");
+    }
+    if (hashScheme == HASH_SCHEME_SEEDED && k + 1 > HASHED_KEY_MAX_SEEDS){
+        throw std::invalid_argument("Too many hash functions for a sharded filter under HASH_SCHEME_SEEDED");
+    }
+    uint64_t shardN = (n + shards - 1) / shards;
+    uint64_t shardR = (r + shards - 1) / shards;
+    for (uint i = 0; i < shards; i++){
+        this->shards.emplace_back(new Shard(shardN, shardR > 0 ? shardR : 1, fpRate, hashScheme,
+                                            powerOfTwo, seed));
+    }
+}
+
+inline uint ShardedDeletableBloomFilter::shardIndex(const HashedKey& key){
+    uint32_t route;
+    if (hashScheme == HASH_SCHEME_SEEDED){
+        if (key.getHashScheme() != hashScheme){
+            throw std::invalid_argument("HashedKey hashed with another hash scheme");
+        }
+        if (key.getSeeds() <= k){
+            throw std::invalid_argument("HashedKey has no seed left to route it to a shard");
+        }
+        route = key.getSeeded(k);
+    }else{
+        route = (uint32_t) key.getHashes()[0];
+    }
+    return ((uint64_t) route * shards.size()) >> 32;
+}
+
+inline ShardedDeletableBloomFilter::Shard& ShardedDeletableBloomFilter::shardOf(const HashedKey& key){
+    return *shards[shardIndex(key)];
+}
+
+/// <summary>
+/// Returns the number of items added to the filter, over all the shards.
+/// </summary>
+/// <returns>The number of items added to the filter</returns>
+uint64_t ShardedDeletableBloomFilter::getCount(){
+    uint64_t c = 0;
+    for (auto& shard : shards){
+        std::lock_guard<std::mutex> lock(shard->lock);
+        c += shard->filter.getCount();
+    }
+    return c;
+}
+
+/// <summary>
+/// Returns the number of shards.
+/// </summary>
+/// <returns>The number of shards</returns>
+uint ShardedDeletableBloomFilter::getShards(){
+    return shards.size();
+}
+
+/// <summary>
+/// Returns the scheme used to derive the bucket indices.
+/// </summary>
+/// <returns>The hash scheme of the filter</returns>
+HashScheme ShardedDeletableBloomFilter::getHashScheme(){
+    return hashScheme;
+}
+
+/// <summary>
+/// Returns the seed of the hashes.
+/// </summary>
+/// <returns>The seed of the filter</returns>
+uint64_t ShardedDeletableBloomFilter::getSeed(){
+    return seed;
+}
+
+/// <summary>
+/// Hashes the data into a key accepted by the HashedKey operations, which
+/// can be computed outside of any lock and reused.
+/// </summary>
+/// <param name="data">The data to hash.</param>
+/// <returns>The hashed data</returns>
+HashedKey ShardedDeletableBloomFilter::hashKey(const char* data, int len){
+    // Under the seeded scheme, the hash with seed k routes the key.
+    return HashedKey(data, len, hashScheme, k + 1, seed);
+}
+
+/// <summary>
+/// Will test for membership of the data and returns true if it is a member,
+/// false if not. This is a probabilistic test, meaning there is a non-zero
+/// probability of false positives but a zero probability of false negatives.
+/// </summary>
+/// <param name="data">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool ShardedDeletableBloomFilter::test(const char* data, int len){
+    return test(hashKey(data, len));
+}
+
+/// <summary>
+/// Will add the data to the Bloom filter.
+/// </summary>
+/// <param name="data">The data to add.</param>
+void ShardedDeletableBloomFilter::add(const char* data, int len){
+    add(hashKey(data, len));
+}
+
+/// <summary>
+/// Is equivalent to calling Test followed by Add, atomically. It returns
+/// true if the data is a member, false if not.
+/// </summary>
+/// <param name="data">The data to test for and add if it doesn't exist.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool ShardedDeletableBloomFilter::testAndAdd(const char* data, int len){
+    return testAndAdd(hashKey(data, len));
+}
+
+/// <summary>
+/// Will test for membership of the data and remove it from the filter if it
+/// exists, atomically: of two threads removing the same item, only one
+/// succeeds. Returns true if the data was a member, false if not.
+/// </summary>
+/// <param name="data">The data to test for and remove</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool ShardedDeletableBloomFilter::testAndRemove(const char* data, int len){
+    return testAndRemove(hashKey(data, len));
+}
+
+/// <summary>
+/// Same as Test, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool ShardedDeletableBloomFilter::test(std::string_view key){
+    return test(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as Add, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to add.</param>
+void ShardedDeletableBloomFilter::add(std::string_view key){
+    add(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool ShardedDeletableBloomFilter::testAndAdd(std::string_view key){
+    return testAndAdd(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key given as a string_view. Throws
+/// std::invalid_argument if it is longer than INT_MAX bytes.
+/// </summary>
+/// <param name="key">The data to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool ShardedDeletableBloomFilter::testAndRemove(std::string_view key){
+    return testAndRemove(key.data(), keyLength(key.size()));
+}
+
+/// <summary>
+/// Same as Test, for a key returned by HashKey, or built with the scheme
+/// and seed of the filter and at least k + 1 seeds under the seeded
+/// scheme. Throws std::invalid_argument for other keys.
+/// </summary>
+/// <param name="key">The hashed data to search for.</param>
+/// <returns>Whether or not the data is maybe contained in the filter.</returns>
+bool ShardedDeletableBloomFilter::test(const HashedKey& key){
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    return shard.filter.test(key);
+}
+
+/// <summary>
+/// Same as Add, for a key hashed beforehand. Throws std::invalid_argument as
+/// Test does.
+/// </summary>
+/// <param name="key">The hashed data to add.</param>
+void ShardedDeletableBloomFilter::add(const HashedKey& key){
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    shard.filter.add(key);
+}
+
+/// <summary>
+/// Same as TestAndAdd, for a key hashed beforehand. Throws
+/// std::invalid_argument as Test does.
+/// </summary>
+/// <param name="key">The hashed data to test for and add.</param>
+/// <returns>Whether or not the data was probably contained in the filter.</returns>
+bool ShardedDeletableBloomFilter::testAndAdd(const HashedKey& key){
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    return shard.filter.testAndAdd(key);
+}
+
+/// <summary>
+/// Same as TestAndRemove, for a key hashed beforehand. Throws
+/// std::invalid_argument as Test does.
+/// </summary>
+/// <param name="key">The hashed data to test for and remove.</param>
+/// <returns>Whether or not the data was a member before this call</returns>
+bool ShardedDeletableBloomFilter::testAndRemove(const HashedKey& key){
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    return shard.filter.testAndRemove(key);
+}
+
+template <typename Op>
+void ShardedDeletableBloomFilter::batch(const Key* keys, size_t n, uint8_t* results, Op op){
+    std::vector<HashedKey> hashed;
+    hashed.reserve(n < SHARD_BATCH ? n : SHARD_BATCH);
+    uint32_t route[SHARD_BATCH];
+    uint32_t order[SHARD_BATCH];
+    std::vector<uint32_t> start(shards.size() + 1);
+    for (size_t base = 0; base < n; base += SHARD_BATCH){
+        size_t chunk = n - base < SHARD_BATCH ? n - base : SHARD_BATCH;
+
+        // Hash the keys outside of any lock, then sort them by shard, keeping
+        // their order within a shard.
+        hashed.clear();
+        std::fill(start.begin(), start.end(), 0);
+        for (size_t j = 0; j < chunk; j++){
+            hashed.push_back(hashKey(keys[base + j].data, keys[base + j].len));
+            route[j] = shardIndex(hashed[j]);
+            start[route[j] + 1]++;
+        }
+        for (size_t s = 0; s < shards.size(); s++){
+            start[s + 1] += start[s];
+        }
+        for (size_t j = 0; j < chunk; j++){
+            order[start[route[j]]++] = j;
+        }
+
+        // start[s] is now the end of shard s, and the beginning of shard s + 1.
+        uint32_t begin = 0;
+        for (size_t s = 0; s < shards.size(); s++){
+            if (begin == start[s]){
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(shards[s]->lock);
+            for (; begin < start[s]; begin++){
+                uint8_t result = op(shards[s]->filter, hashed[order[begin]]);
+                if (results){
+                    results[base + order[begin]] = result;
+                }
+            }
+        }
+    }
+}
+
+/// <summary>
+/// Tests the membership of n items, as n calls to Test would. The keys are
+/// grouped per shard SHARD_BATCH at a time, and each shard is locked once
+/// per group.
+/// </summary>
+/// <param name="keys">The data to search for.</param>
+/// <param name="n">Number of keys.</param>
+/// <param name="results">Set to 1 for the keys that are maybe contained in
+/// the filter, 0 otherwise.</param>
+void ShardedDeletableBloomFilter::testBatch(const Key* keys, size_t n, uint8_t* results){
+    batch(keys, n, results, [](DeletableBloomFilter& filter, const HashedKey& key){
+        return filter.test(key);
+    });
+}
+
+/// <summary>
+/// Adds n items, with the same result as n calls to Add in order. The keys
+/// are grouped per shard as in TestBatch.
+/// </summary>
+/// <param name="keys">The data to add.</param>
+/// <param name="n">Number of keys.</param>
+void ShardedDeletableBloomFilter::addBatch(const Key* keys, size_t n){
+    batch(keys, n, NULL, [](DeletableBloomFilter& filter, const HashedKey& key){
+        filter.add(key);
+        return true;
+    });
+}
+
+/// <summary>
+/// Tests and removes n items, with the same result as n calls to
+/// TestAndRemove in order. The keys are grouped per shard as in TestBatch.
+/// </summary>
+/// <param name="keys">The data to test for and remove.</param>
+/// <param name="n">Number of keys.</param>
+/// <param name="results">Set to 1 for the keys that were members before the
+/// call, 0 otherwise.</param>
+void ShardedDeletableBloomFilter::removeBatch(const Key* keys, size_t n, uint8_t* results){
+    batch(keys, n, results, [](DeletableBloomFilter& filter, const HashedKey& key){
+        return filter.testAndRemove(key);
+    });
+}
+
+/// <summary>
+/// Restores the Bloom filter to its original state, one shard at a time.
+/// </summary>
+void ShardedDeletableBloomFilter::reset(){
+    for (auto& shard : shards){
+        std::lock_guard<std::mutex> lock(shard->lock);
+        shard->filter.reset();
+    }
+}
@@ -0,0 +1,249 @@
+/// ShardedDeletableBloomFilter splits a DeletableBloomFilter into independent
+/// shards, each one guarded by its own lock, for workloads that need the
+/// operations to stay atomic, such as a TestAndRemove atomic with its own
+/// test, which the lock-free ConcurrentDeletableBloomFilter does not offer.
+///
+/// Each key is hashed once into a HashedKey, which both routes it to a shard
+/// and gives its bucket indices inside that shard. The route is taken from
+/// hash bits the indices do not use, so that the keys of a shard are still
+/// spread uniformly over its buckets:
+/// - under HASH_SCHEME_SEEDED, an extra hash with seed k, after the k seeds of
+///   the indices,
+/// - under the double hashing schemes, the low 32 bits of the first hash,
+///   which fast range only reaches through carries for filters of up to 2^32
+///   buckets per shard.
+///
+/// Every shard is sized with optimalM for its share of the n items, so that
+/// the false-positive rate of the filter is that of a single shard. The locks
+/// are padded to their own cache line, and the batch operations group the keys
+/// per shard to take each lock once.
+
+#ifndef _SHARDED_BF_H_
+#define _SHARDED_BF_H_
+
+#include "bitset.h"
+#include "del-bf.h"
+#include "indexer.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Number of keys the batch operations hash and group per shard at a time.
+#define SHARD_BATCH (256)
+
+class ShardedDeletableBloomFilter{
+public:
+    /// An item passed to the batch operations.
+    typedef DeletableBloomFilter::Key Key;
+
+private:
+    /// A shard and its lock, alone in their cache lines.
+    struct alignas(BITSET_ALIGNMENT) Shard{
+        std::mutex lock;
+        DeletableBloomFilter filter;
+
+        Shard(uint64_t n, uint64_t r, double fpRate, HashScheme hashScheme, bool powerOfTwo, uint64_t seed) :
+                filter(n, r, fpRate, hashScheme, powerOfTwo, seed){}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards; /// The shards
+    HashScheme hashScheme; /// Scheme used to derive the bucket indices
+    uint64_t seed; /// Seed of the hashes
+    uint k; /// Number of hash functions of every shard
+
+    /// Returns the index of the shard of a key hashed by hashKey(). Throws
+    /// std::invalid_argument if the key cannot be routed.
+    uint shardIndex(const HashedKey& key);
+
+    /// Returns the shard of a key hashed by hashKey().
+    Shard& shardOf(const HashedKey& key);
+
+    /// Applies op to n keys, SHARD_BATCH at a time, locking each shard once
+    /// per group of keys. The keys of a shard are applied in order.
+    template <typename Op> void batch(const Key* keys, size_t n, uint8_t* results, Op op);
+
+public:
+    /// <summary>
+    /// Creates a new ShardedDeletableBloomFilter optimized to store n items with
+    /// a specified target false-positive rate, split into the given number of
+    /// shards of n / shards items and r / shards collision bits each. Throws
+    /// std::invalid_argument if shards is 0, and if the seeded scheme needs
+    /// more hashes than a HashedKey holds.
+    /// </summary>
+    /// <param name="n">Number of items</param>
+    /// <param name="r">Number of bits to use to store collision information</param>
+    /// <param name="fpRate">Desired false positive rate</param>
+    /// <param name="shards">Number of shards, a few times the number of
+    /// threads to keep the contention low</param>
+    /// <param name="hashScheme">Scheme used to derive the bucket indices</param>
+    /// <param name="powerOfTwo">Whether to round the number of buckets of each
+    /// shard up to a power of two, see DeletableBloomFilter</param>
+    /// <param name="seed">Seed of the hashes, see DeletableBloomFilter</param>
+    ShardedDeletableBloomFilter(uint64_t n, uint64_t r, double fpRate, uint shards,
+                                HashScheme hashScheme = HASH_SCHEME_SEEDED,
+                                bool powerOfTwo = false, uint64_t seed = 0);
+
+    /// <summary>
+    /// Returns the number of items added to the filter, over all the shards.
+    /// </summary>
+    /// <returns>The number of items added to the filter</returns>
+    uint64_t getCount();
+
+    /// <summary>
+    /// Returns the number of shards.
+    /// </summary>
+    /// <returns>The number of shards</returns>
+    uint getShards();
+
+    /// <summary>
+    /// Returns the scheme used to derive the bucket indices.
+    /// </summary>
+    /// <returns>The hash scheme of the filter</returns>
+    HashScheme getHashScheme();
+
+    /// <summary>
+    /// Returns the seed of the hashes.
+    /// </summary>
+    /// <returns>The seed of the filter</returns>
+    uint64_t getSeed();
+
+    /// <summary>
+    /// Hashes the data into a key accepted by the HashedKey operations, which
+    /// can be computed outside of any lock and reused.
+    /// </summary>
+    /// <param name="data">The data to hash.</param>
+    /// <returns>The hashed data</returns>
+    HashedKey hashKey(const char* data, int len);
+
+    /// <summary>
+    /// Will test for membership of the data and returns true if it is a member,
+    /// false if not. This is a probabilistic test, meaning there is a non-zero
+    /// probability of false positives but a zero probability of false negatives.
+    /// </summary>
+    /// <param name="data">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const char* data, int len);
+
+    /// <summary>
+    /// Will add the data to the Bloom filter.
+    /// </summary>
+    /// <param name="data">The data to add.</param>
+    void add(const char* data, int len);
+
+    /// <summary>
+    /// Is equivalent to calling Test followed by Add, atomically. It returns
+    /// true if the data is a member, false if not.
+    /// </summary>
+    /// <param name="data">The data to test for and add if it doesn't exist.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const char* data, int len);
+
+    /// <summary>
+    /// Will test for membership of the data and remove it from the filter if it
+    /// exists, atomically: of two threads removing the same item, only one
+    /// succeeds. Returns true if the data was a member, false if not.
+    /// </summary>
+    /// <param name="data">The data to test for and remove</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const char* data, int len);
+
+    /// <summary>
+    /// Same as Test, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(std::string_view key);
+
+    /// <summary>
+    /// Same as Add, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to add.</param>
+    void add(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(std::string_view key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key given as a string_view. Throws
+    /// std::invalid_argument if it is longer than INT_MAX bytes.
+    /// </summary>
+    /// <param name="key">The data to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(std::string_view key);
+
+    /// <summary>
+    /// Same as Test, for a key returned by HashKey, or built with the scheme
+    /// and seed of the filter and at least k + 1 seeds under the seeded
+    /// scheme. Throws std::invalid_argument for other keys.
+    /// </summary>
+    /// <param name="key">The hashed data to search for.</param>
+    /// <returns>Whether or not the data is maybe contained in the filter.</returns>
+    bool test(const HashedKey& key);
+
+    /// <summary>
+    /// Same as Add, for a key hashed beforehand. Throws std::invalid_argument as
+    /// Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to add.</param>
+    void add(const HashedKey& key);
+
+    /// <summary>
+    /// Same as TestAndAdd, for a key hashed beforehand. Throws
+    /// std::invalid_argument as Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to test for and add.</param>
+    /// <returns>Whether or not the data was probably contained in the filter.</returns>
+    bool testAndAdd(const HashedKey& key);
+
+    /// <summary>
+    /// Same as TestAndRemove, for a key hashed beforehand. Throws
+    /// std::invalid_argument as Test does.
+    /// </summary>
+    /// <param name="key">The hashed data to test for and remove.</param>
+    /// <returns>Whether or not the data was a member before this call</returns>
+    bool testAndRemove(const HashedKey& key);
+
+    /// <summary>
+    /// Tests the membership of n items, as n calls to Test would. The keys are
+    /// grouped per shard SHARD_BATCH at a time, and each shard is locked once
+    /// per group.
+    /// </summary>
+    /// <param name="keys">The data to search for.</param>
+    /// <param name="n">Number of keys.</param>
+    /// <param name="results">Set to 1 for the keys that are maybe contained in
+    /// the filter, 0 otherwise.</param>
+    void testBatch(const Key* keys, size_t n, uint8_t* results);
+
+    /// <summary>
+    /// Adds n items, with the same result as n calls to Add in order. The keys
+    /// are grouped per shard as in TestBatch.
+    /// </summary>
+    /// <param name="keys">The data to add.</param>
+    /// <param name="n">Number of keys.</param>
+    void addBatch(const Key* keys, size_t n);
+
+    /// <summary>
+    /// Tests and removes n items, with the same result as n calls to
+    /// TestAndRemove in order. The keys are grouped per shard as in TestBatch.
+    /// </summary>
+    /// <param name="keys">The data to test for and remove.</param>
+    /// <param name="n">Number of keys.</param>
+    /// <param name="results">Set to 1 for the keys that were members before the
+    /// call, 0 otherwise.</param>
+    void removeBatch(const Key* keys, size_t n, uint8_t* results);
+
+    /// <summary>
+    /// Restores the Bloom filter to its original state, one shard at a time.
+    /// </summary>
+    void reset();
+};
+
+#endif // _SHARDED_BF_H_
@@ -0,0 +1,231 @@
+/// Saving and loading of DeletableBloomFilter snapshots, see snapshot.h for the
+/// format.
+
+#include "del-bf.h"
+#include "snapshot.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// Number of bytes hashed at a time by the checksum.
+#define CHECKSUM_CHUNK (1 << 20)
+
+/// Folds bytes into a running checksum.
+static uint64_t checksumUpdate(uint64_t c, const void* data, size_t len){
+    const char* p = (const char*) data;
+    while (len){
+        size_t chunk = len < CHECKSUM_CHUNK ? len : CHECKSUM_CHUNK;
+        uint64_t h[2];
+        MurmurHash3_x64_128(p, chunk, (uint32_t) c, (void*) h);
+        c = (c ^ h[0]) * 0x9e3779b97f4a7c15ULL + h[1];
+        p += chunk;
+        len -= chunk;
+    }
+    return c;
+}
+
+/// Returns the checksum of a snapshot, the words following its header.
+static uint64_t checksum(SnapshotHeader header, const uint64_t* buckets,
+                         const uint64_t* collisions){
+    header.checksum = 0;
+    uint64_t c = checksumUpdate(0, &header, sizeof(header));
+    c = checksumUpdate(c, buckets, header.bucketWords * sizeof(uint64_t));
+    return checksumUpdate(c, collisions, header.collisionWords * sizeof(uint64_t));
+}
+
+static void fail(const char* what, const char* path){
+    throw std::runtime_error(std::string(what) + ": " + path);
+}
+
+/// Reads exactly len bytes at the given offset.
+static void readAt(int fd, void* data, size_t len, off_t offset, const char* path){
+    char* p = (char*) data;
+    while (len){
+        ssize_t r = pread(fd, p, len, offset);
+        if (r <= 0){
+            fail("Cannot read snapshot", path);
+        }
+        p += r;
+        len -= r;
+        offset += r;
+    }
+}
+
+/// Checks that a header describes a valid snapshot of the given size.
+static void validate(const SnapshotHeader& header, uint64_t size, const char* path){
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic))){
+        fail("Not a snapshot", path);
+    }
+    // The marker is checked before the version, which is swapped as well.
+    if (header.byteOrder == __builtin_bswap64(SNAPSHOT_BYTE_ORDER)){
+        fail("Snapshot written with a different byte order", path);
+    }
+    // Version 1 snapshots only differ by their seed field, always 0, and
+    // versions 1 and 2 by the byte order marker, always 0.
+    if (header.version < 1 || header.version > SNAPSHOT_VERSION){
+        fail("Unsupported snapshot version", path);
+    }
+    if (header.byteOrder != (header.version >= 3 ? SNAPSHOT_BYTE_ORDER : 0)){
+        fail("Corrupted snapshot", path);
+    }
+    if (!hashSchemeSupported((HashScheme) header.hashScheme)){
+        fail("Unsupported hash scheme", path);
+    }
+    // The sizes are bounded before anything is computed from them, so that
+    // nothing below wraps around: with r <= m < 2^61, the words of a snapshot
+    // take less than 2^60 bytes.
+    if (!header.m || !header.r || header.r > header.m || header.m > UINT64_MAX / 8 ||
+        !header.k || header.k > UINT32_MAX ||
+        (header.hashScheme == HASH_SCHEME_SEEDED && header.m > UINT32_MAX) ||
+        header.regionSize != header.m / header.r + (header.m % header.r != 0) ||
+        header.bucketWords != (header.m + 63) / 64 ||
+        header.collisionWords != (header.r + 63) / 64 ||
+        size != sizeof(header) + (header.bucketWords + header.collisionWords) * sizeof(uint64_t)){
+        fail("Corrupted snapshot", path);
+    }
+}
+
+/// <summary>
+/// Saves a snapshot of the filter to a file, in the format described in
+/// snapshot.h. Throws std::runtime_error if the file cannot be written.
+/// </summary>
+/// <param name="path">Path of the snapshot file</param>
+void DeletableBloomFilter::save(const char* path){
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.hashScheme = indexer.getHashScheme();
+    header.m = indexer.getM();
+    header.r = collisions.getSize();
+    header.regionSize = indexer.getRegionSize();
+    header.k = indexer.getK();
+    header.count = count;
+    header.seed = indexer.getSeed();
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.bucketWords = buckets.getNumWords();
+    header.collisionWords = collisions.getNumWords();
+    header.checksum = checksum(header, buckets.getWords(), collisions.getWords());
+
+    // The snapshot is written aside, synced and renamed over the destination,
+    // so that readers, including processes that mapped the previous snapshot,
+    // never see a partially written file, even after a crash. The temporary
+    // file has a unique name, so that concurrent saves to the same path do not
+    // write into each other's file.
+    std::string tmp = std::string(path) + ".XXXXXX";
+    int fd = mkstemp(&tmp[0]);
+    if (fd < 0){
+        fail("Cannot create snapshot", tmp.c_str());
+    }
+    FILE* f = fdopen(fd, "wb");
+    if (!f){
+        close(fd);
+        unlink(tmp.c_str());
+        fail("Cannot create snapshot", tmp.c_str());
+    }
+    bool ok = fchmod(fd, 0644) == 0 &&
+              fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(buckets.getWords(), sizeof(uint64_t), header.bucketWords, f) == header.bucketWords &&
+              fwrite(collisions.getWords(), sizeof(uint64_t), header.collisionWords, f) == header.collisionWords &&
+              fflush(f) == 0 && fsync(fd) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path)){
+        unlink(tmp.c_str());
+        fail("Cannot write snapshot", path);
+    }
+
+    // Sync the directory as well, so that the rename itself is durable.
+    std::string dir(path);
+    size_t slash = dir.rfind('/');
+    dir = slash == std::string::npos ? "." : slash ? dir.substr(0, slash) : "/";
+    int dirFd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd >= 0){
+        fsync(dirFd);
+        close(dirFd);
+    }
+}
+
+DeletableBloomFilter DeletableBloomFilter::open(const char* path, bool mapped, bool verify){
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0){
+        fail("Cannot open snapshot", path);
+    }
+    struct stat st;
+    SnapshotHeader header;
+    if (fstat(fd, &st) || (size_t) st.st_size < sizeof(header)){
+        close(fd);
+        fail("Not a snapshot", path);
+    }
+
+    DeletableBloomFilter dbf;
+    try{
+        readAt(fd, &header, sizeof(header), 0, path);
+        validate(header, st.st_size, path);
+        uint64_t* words;
+        if (mapped){
+            void* p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED){
+                fail("Cannot map snapshot", path);
+            }
+            size_t size = st.st_size;
+            dbf.mapping = std::shared_ptr<void>(p, [size](void* p){ munmap(p, size); });
+            words = (uint64_t*) ((char*) p + sizeof(header));
+            dbf.buckets = Bitset::view(words, header.m);
+            dbf.collisions = Bitset::view(words + header.bucketWords, header.r);
+        }else{
+            dbf.buckets = Bitset(header.m);
+            dbf.collisions = Bitset(header.r);
+            readAt(fd, dbf.buckets.getWords(), header.bucketWords * sizeof(uint64_t),
+                   sizeof(header), path);
+            readAt(fd, dbf.collisions.getWords(), header.collisionWords * sizeof(uint64_t),
+                   sizeof(header) + header.bucketWords * sizeof(uint64_t), path);
+        }
+        if (verify && checksum(header, dbf.buckets.getWords(), dbf.collisions.getWords()) != header.checksum){
+            fail("Snapshot checksum mismatch", path);
+        }
+    }catch (...){
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    dbf.indexer = Indexer(header.m, header.r, header.k, (HashScheme) header.hashScheme, header.seed);
+    dbf.count = header.count;
+    return dbf;
+}
+
+/// <summary>
+/// Loads a filter from a snapshot saved with Save, copying its data.
+/// Throws std::runtime_error if the file cannot be read, is not a valid
+/// snapshot or does not match its checksum.
+/// </summary>
+/// <param name="path">Path of the snapshot file</param>
+/// <returns>The filter stored in the snapshot</returns>
+DeletableBloomFilter DeletableBloomFilter::load(const char* path){
+    return open(path, false, true);
+}
+
+/// <summary>
+/// Opens a filter from a snapshot saved with Save without copying its data:
+/// the buckets and the collision regions are served straight from the
+/// memory-mapped file, and pages are only read from disk when first
+/// accessed. The filter can still be modified, but the changes are private
+/// to the process and are never written back to the file. Throws
+/// std::runtime_error if the file cannot be mapped or is not a valid
+/// snapshot.
+/// </summary>
+/// <param name="path">Path of the snapshot file</param>
+/// <param name="verify">Whether to verify the checksum, which reads the
+/// whole file</param>
+/// <returns>The filter stored in the snapshot</returns>
+DeletableBloomFilter DeletableBloomFilter::openMapped(const char* path, bool verify){
+    return open(path, true, verify);
+}
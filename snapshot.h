@@ -0,0 +1,39 @@
+/// On-disk format of a DeletableBloomFilter snapshot. A snapshot is made of:
+///
+///   | header (128 bytes) | bucket words | collision words |
+///
+/// All the fields and words are stored in the native byte order. Since
+/// version 3, the header records SNAPSHOT_BYTE_ORDER in that order, so that a
+/// snapshot written on a host of the other byte order is rejected. The words
+/// start on a 64-byte boundary, so that a memory-mapped snapshot can be used
+/// in place.
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <cstdint>
+
+#define SNAPSHOT_MAGIC "DBFSNAP"
+#define SNAPSHOT_VERSION (3)
+#define SNAPSHOT_BYTE_ORDER (0x0102030405060708ULL)
+
+struct SnapshotHeader{
+    char magic[8]; /// SNAPSHOT_MAGIC, NUL terminated
+    uint32_t version; /// Format version, SNAPSHOT_VERSION
+    uint32_t hashScheme; /// HashScheme of the filter
+    uint64_t m; /// Number of buckets
+    uint64_t r; /// Number of collision regions
+    uint64_t regionSize; /// Number of bits in a region
+    uint64_t k; /// Number of hash functions
+    uint64_t count; /// Number of items in the filter
+    uint64_t bucketWords; /// Number of bucket words following the header
+    uint64_t collisionWords; /// Number of collision words following them
+    uint64_t checksum; /// Checksum of the header, with this field set to 0, and of the words
+    uint64_t seed; /// Seed of the hashes, since version 2 (0 in version 1 snapshots)
+    uint64_t byteOrder; /// SNAPSHOT_BYTE_ORDER, since version 3 (0 before)
+    uint64_t reserved[4]; /// Must be 0
+};
+
+static_assert(sizeof(SnapshotHeader) == 128, "Snapshot header must be 128 bytes");
+
+#endif // _SNAPSHOT_H_
@@ -1,6 +1,22 @@
+#include "blocked-bf.h"
+#include "concurrent-bf.h"
 #include "del-bf.h"
+#include "epoch-bf.h"
+#include "fixed-bf.h"
+#include "hash-simd.h"
+#include "numa-bf.h"
+#include "sharded-bf.h"
+#include "snapshot.h"
 
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 #define ADD_UINT32(INT) {x = INT; dbf.add((char*) &x, 4);}
 #define TEST_UINT32_SUCCESS(INT) {x = INT; assert(dbf.test((char*) &x, 4));}
@@ -8,9 +24,169 @@
 #define TEST_AND_REMOVE_UINT32_SUCCESS(INT) {x = INT; assert(dbf.testAndRemove((char*) &x, 4));}
 #define TEST_AND_REMOVE_UINT32_FAILURE(INT) {x = INT; assert(!dbf.testAndRemove((char*) &x, 4));}
 
-int main(int argc, char** argv){
-    DeletableBloomFilter dbf(128, 128, 0.1);
+static void testBitset(){
+    Bitset a(130), b(130);
+    a.set(0);
+    a.set(129);
+    assert(a.get(0) && a.get(129) && !a.get(64));
+    assert(!a.testAndSet(64));
+    assert(a.testAndSet(64));
+    a.clearIf(64, false);
+    assert(a.get(64));
+    a.clearIf(64, true);
+    assert(!a.get(64));
+    b.set(1);
+    b.orWith(a);
+    assert(b.popcount() == 3);
+    Bitset c(b);
+    assert(c.get(1) && c.get(129));
+    b.reset();
+    assert(b.popcount() == 0 && c.popcount() == 3);
+}
+
+static void testDivisor(){
+    uint32_t divisors[] = {1, 2, 3, 7, 64, 486, 1000003, 0x7fffffff, 0x80000000, 0xffffffff};
+    uint32_t values[] = {0, 1, 2, 63, 64, 485, 486, 1000002, 0x7fffffff, 0xfffffffe, 0xffffffff};
+    for (uint32_t d : divisors){
+        Divisor divisor(d);
+        for (uint32_t a : values){
+            assert(divisor.div(a) == a / d);
+            assert(divisor.mod(a) == a % d);
+        }
+        uint32_t a = 12345;
+        for (uint i = 0; i < 100000; i++){
+            a = a * 1664525 + 1013904223;
+            assert(divisor.div(a) == a / d);
+            assert(divisor.mod(a) == a % d);
+        }
+    }
+    assert(nextPowerOfTwo(1) == 1 && nextPowerOfTwo(486) == 512 && nextPowerOfTwo(512) == 512);
+    assert(nextPowerOfTwo(((uint64_t) 1 << 33) + 1) == (uint64_t) 1 << 34);
+
+    uint64_t wideDivisors[] = {3, 1000003, 0xffffffff, 0x100000001ULL, 0x123456789abULL, UINT64_MAX};
+    for (uint64_t d : wideDivisors){
+        Divisor divisor(d, UINT64_MAX);
+        uint64_t a = 12345;
+        assert(divisor.div(UINT64_MAX) == UINT64_MAX / d);
+        assert(divisor.div(d - 1) == 0 && divisor.div(d) == 1);
+        for (uint i = 0; i < 100000; i++){
+            a = a * 6364136223846793005ULL + 1442695040888963407ULL;
+            assert(divisor.div(a) == a / d);
+        }
+    }
+}
+
+static void testHashSimd(){
+    // Every length, including the tails, and every number of keys up to two
+    // full AVX-512 vectors plus an AVX2 one and scalar leftovers.
+    char data[41 * 64];
+    for (size_t i = 0; i < sizeof(data); i++){
+        data[i] = (char) (i * 131 + 7);
+    }
+    const void* keys[41];
+    uint32_t out[41], expected;
+    for (int len = 0; len <= 37; len++){
+        for (size_t n = 0; n <= 41; n += 3){
+            for (size_t j = 0; j < n; j++){
+                keys[j] = data + j * 64 + j % 5;
+            }
+            MurmurHash3_x86_32_keys(keys, len, len * 17, out, n);
+            for (size_t j = 0; j < n; j++){
+                MurmurHash3_x86_32(keys[j], len, len * 17, &expected);
+                assert(out[j] == expected);
+            }
+
+            MurmurHash3_x86_32_seeds(data + len, len, len * 17, out, n);
+            for (size_t j = 0; j < n; j++){
+                MurmurHash3_x86_32(data + len, len, len * 17 + j, &expected);
+                assert(out[j] == expected);
+            }
+        }
+    }
+
+    // The seeded indices of an Indexer with more hash functions than lanes,
+    // visited in and out of order.
+    Indexer indexer(1000003, 1000, 37, HASH_SCHEME_SEEDED);
+    ItemHash h;
+    uint64_t idx[37];
+    indexer.indices(data, 13, idx);
+    for (uint i = 0; i < 37; i++){
+        MurmurHash3_x86_32(data, 13, i, &expected);
+        assert(idx[i] == expected % 1000003);
+    }
+    indexer.hash(data, 13, h);
+    for (uint i : {20u, 3u, 36u, 0u, 16u, 15u}){
+        assert(indexer.index(data, 13, h, i) == idx[i]);
+    }
+}
+
+static void testHashEngines(){
+    assert(crc32c("123456789", 9) == 0xe3069283);
+    assert(wyhash("", 0, 0) == 0x93228a4de0eec5a2ULL);
+    assert(wyhash("a", 1, 1) == 0xc5bac3db178713c4ULL);
+
+    // Reference vectors of SipHash-2-4-128, key 00..0f, messages 00..len-1.
+    uint64_t k0 = 0x0706050403020100ULL, k1 = 0x0f0e0d0c0b0a0908ULL, sip[2];
+    const char message[] = "\x00";
+    siphash128(message, 0, k0, k1, sip);
+    assert(sip[0] == 0xe6a825ba047f81a3ULL && sip[1] == 0x930255c71472f66dULL);
+    siphash128(message, 1, k0, k1, sip);
+    assert(sip[0] == 0x44af996bd8c187daULL && sip[1] == 0x45fc229b11597634ULL);
+
+    bool thrown = false;
+    try{
+        DeletableBloomFilter dbf(128, 128, 0.1, (HashScheme) 99);
+    }catch (const std::invalid_argument&){
+        thrown = true;
+    }
+    assert(thrown);
+    thrown = false;
+    try{
+        DeletableBloomFilter dbf(128, 128, 0.1, HASH_SCHEME_XXH3);
+    }catch (const std::invalid_argument&){
+        thrown = true;
+    }
+    assert(thrown == !hashSchemeSupported(HASH_SCHEME_XXH3));
+}
+
+static void testWide(){
+    // Indices and regions of a filter larger than 2^32 bits.
+    uint64_t m = ((uint64_t) 1 << 34) + 12345, r = (uint64_t) 1 << 20;
+    Indexer indexer(m, r, 10, HASH_SCHEME_DOUBLE);
+    uint64_t idx[10], high = 0;
+    for (uint32_t x = 0; x < 10000; x++){
+        indexer.indices((char*) &x, 4, idx);
+        for (uint i = 0; i < 10; i++){
+            assert(idx[i] < m);
+            assert(indexer.region(idx[i]) == idx[i] / indexer.getRegionSize());
+            assert(indexer.region(idx[i]) < r);
+            high += idx[i] >> 32;
+        }
+    }
+    // The average of idx >> 32 is 1.5 for indices uniform over [0, 2^34).
+    assert(high > 145000 && high < 155000);
+
+    bool thrown = false;
+    try{
+        Indexer seeded(m, r, 10, HASH_SCHEME_SEEDED);
+    }catch (const std::invalid_argument&){
+        thrown = true;
+    }
+    assert(thrown);
+
+    thrown = false;
+    try{
+        DeletableBloomFilter::optimalM(UINT64_MAX, 1e-9);
+    }catch (const std::overflow_error&){
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+static void testBasic(HashScheme hashScheme, bool powerOfTwo = false){
+    DeletableBloomFilter dbf(128, 128, 0.1, hashScheme, powerOfTwo);
     uint32_t x;
+    assert(dbf.getHashScheme() == hashScheme);
     ADD_UINT32(2);
     ADD_UINT32(4);
     ADD_UINT32(6);
@@ -25,4 +201,925 @@ int main(int argc, char** argv){
     TEST_AND_REMOVE_UINT32_SUCCESS(4);
     TEST_AND_REMOVE_UINT32_SUCCESS(6);
     TEST_AND_REMOVE_UINT32_FAILURE(3);
-}
\ No newline at end of file
+}
+
+static void testBlocked(){
+    BlockedDeletableBloomFilter dbf(128, 128, 0.1);
+    uint32_t x;
+    ADD_UINT32(2);
+    ADD_UINT32(4);
+    ADD_UINT32(6);
+
+    assert(dbf.getCount() == 3);
+    TEST_UINT32_SUCCESS(2);
+    TEST_UINT32_SUCCESS(4);
+    TEST_UINT32_SUCCESS(6);
+    TEST_UINT32_FAILURE(3);
+
+    TEST_AND_REMOVE_UINT32_SUCCESS(2);
+    TEST_AND_REMOVE_UINT32_SUCCESS(4);
+    TEST_AND_REMOVE_UINT32_SUCCESS(6);
+    TEST_AND_REMOVE_UINT32_FAILURE(3);
+    assert(dbf.getCount() == 0);
+}
+
+static void testBatch(HashScheme hashScheme){
+    DeletableBloomFilter serial(1000, 100, 0.01, hashScheme);
+    DeletableBloomFilter batched(1000, 100, 0.01, hashScheme);
+    std::vector<uint32_t> values(2000);
+    std::vector<DeletableBloomFilter::Key> keys(2000);
+    std::vector<uint8_t> results(2000);
+    for (uint32_t i = 0; i < 2000; i++){
+        values[i] = i;
+        keys[i].data = (const char*) &values[i];
+        keys[i].len = sizeof(values[i]);
+    }
+
+    for (uint32_t i = 0; i < 1000; i++){
+        serial.add((char*) &values[i], 4);
+    }
+    batched.addBatch(keys.data(), 1000);
+    assert(batched.getCount() == serial.getCount());
+
+    batched.testBatch(keys.data(), 2000, results.data());
+    for (uint32_t i = 0; i < 2000; i++){
+        assert(results[i] == serial.test((char*) &values[i], 4));
+    }
+
+    batched.removeBatch(keys.data() + 500, 1000, results.data());
+    for (uint32_t i = 500; i < 1500; i++){
+        assert(results[i - 500] == serial.testAndRemove((char*) &values[i], 4));
+    }
+    assert(batched.getCount() == serial.getCount());
+    for (uint32_t i = 0; i < 2000; i++){
+        assert(batched.test((char*) &values[i], 4) == serial.test((char*) &values[i], 4));
+    }
+}
+
+static void testHashedKey(HashScheme hashScheme){
+    // One key hashed once, probed against filters of different sizes.
+    DeletableBloomFilter small(100, 10, 0.1, hashScheme);
+    DeletableBloomFilter large(10000, 1000, 0.001, hashScheme);
+    DeletableBloomFilter raw(10000, 1000, 0.001, hashScheme);
+    ConcurrentDeletableBloomFilter concurrent(10000, 1000, 0.001, hashScheme);
+    for (uint32_t x = 0; x < 2000; x++){
+        HashedKey key((char*) &x, 4, hashScheme);
+        if (x % 2){
+            assert(large.testAndAdd(key) == raw.testAndAdd((char*) &x, 4));
+            small.add(key);
+            concurrent.add(key);
+        }
+    }
+    for (uint32_t x = 0; x < 2000; x++){
+        HashedKey key((char*) &x, 4, hashScheme);
+        assert(large.test(key) == raw.test((char*) &x, 4));
+        assert(small.test(key) == small.test((char*) &x, 4));
+        assert(concurrent.test(key) == concurrent.test((char*) &x, 4));
+        if (x % 3 == 0){
+            assert(large.testAndRemove(key) == raw.testAndRemove((char*) &x, 4));
+            concurrent.testAndRemove(key);
+        }
+    }
+    assert(large.getCount() == raw.getCount());
+    for (uint32_t x = 0; x < 2000; x++){
+        HashedKey key((char*) &x, 4, hashScheme);
+        assert(large.test(key) == raw.test((char*) &x, 4));
+        assert(concurrent.test(key) == raw.test((char*) &x, 4));
+    }
+
+    // Keys of another scheme, or with too few seeds, are rejected.
+    uint32_t x = 1;
+    HashScheme other = hashScheme == HASH_SCHEME_SEEDED ? HASH_SCHEME_DOUBLE : HASH_SCHEME_SEEDED;
+    bool thrown = false;
+    try{
+        large.test(HashedKey((char*) &x, 4, other));
+    }catch (const std::invalid_argument&){
+        thrown = true;
+    }
+    assert(thrown);
+    thrown = false;
+    try{
+        large.add(HashedKey((char*) &x, 4, hashScheme, 2));
+    }catch (const std::invalid_argument&){
+        thrown = true;
+    }
+    assert(thrown == (hashScheme == HASH_SCHEME_SEEDED));
+}
+
+static void testConstexprHash(){
+    // Hashes computed at compile time match the run-time ones.
+    static_assert(MurmurHash3_x86_32("", 0, 0) == 0, "MurmurHash3_x86_32");
+    static_assert(MurmurHash3_x86_32("hello", 5, 0) == 0x248bfa47, "MurmurHash3_x86_32");
+    constexpr MurmurHash128 h128 = MurmurHash3_x64_128("The quick brown fox jumps over the lazy dog", 43, 0);
+    constexpr HashedKey seeded("sentinel", 8);
+    constexpr HashedKey doubled("sentinel", 8, HASH_SCHEME_DOUBLE);
+    static_assert(seeded.getSeeds() == HASHED_KEY_SEEDS, "HashedKey");
+
+    char data[64];
+    for (size_t i = 0; i < sizeof(data); i++){
+        data[i] = (char) (i * 37 + 1);
+    }
+    uint32_t h32;
+    uint64_t h[2];
+    MurmurHash3_x64_128("The quick brown fox jumps over the lazy dog", 43, 0, h);
+    assert(h[0] == h128.h1 && h[1] == h128.h2);
+    for (int len = 0; len <= 40; len++){
+        // Unaligned keys, read with memcpy.
+        MurmurHash3_x86_32(data + 1, len, 7, &h32);
+        assert(h32 == MurmurHash3_x86_32(data + 1, len, 7));
+        MurmurHash3_x64_128(data + 3, len, 7, h);
+        MurmurHash128 r = MurmurHash3_x64_128(data + 3, len, 7);
+        assert(h[0] == r.h1 && h[1] == r.h2);
+    }
+
+    HashedKey seededRuntime((const char*) "sentinel", 8);
+    HashedKey doubledRuntime((const char*) "sentinel", 8, HASH_SCHEME_DOUBLE);
+    for (uint i = 0; i < HASHED_KEY_SEEDS; i++){
+        assert(seeded.getSeeded(i) == seededRuntime.getSeeded(i));
+    }
+    assert(doubled.getHashes()[0] == doubledRuntime.getHashes()[0]);
+    assert(doubled.getHashes()[1] == doubledRuntime.getHashes()[1]);
+
+    DeletableBloomFilter dbf(1000, 100, 0.01);
+    dbf.add((char*) "sentinel", 8);
+    assert(dbf.test(seeded));
+}
+
+static void testFragments(HashScheme hashScheme){
+    char data[600];
+    for (size_t i = 0; i < sizeof(data); i++){
+        data[i] = (char) (i * 53 + 11);
+    }
+    // The incremental hashes match the contiguous ones however the key is cut.
+    for (int len = 0; len <= 40; len++){
+        for (int cut = 0; cut <= len; cut++){
+            MurmurHash3_x86_32_state s32;
+            MurmurHash3_x86_32_init(&s32, 5);
+            MurmurHash3_x86_32_update(&s32, data, cut);
+            MurmurHash3_x86_32_update(&s32, data + cut, (len - cut) / 2);
+            MurmurHash3_x86_32_update(&s32, data + cut + (len - cut) / 2, len - cut - (len - cut) / 2);
+            assert(MurmurHash3_x86_32_final(&s32) == MurmurHash3_x86_32(data, len, 5));
+
+            MurmurHash3_x64_128_state s128;
+            MurmurHash3_x64_128_init(&s128, 5);
+            MurmurHash3_x64_128_update(&s128, data, cut);
+            MurmurHash3_x64_128_update(&s128, data + cut, len - cut);
+            MurmurHash128 h = MurmurHash3_x64_128_final(&s128);
+            MurmurHash128 expected = MurmurHash3_x64_128(data, len, 5);
+            assert(h.h1 == expected.h1 && h.h2 == expected.h2);
+        }
+    }
+
+    // Filter operations on fragments match those on the contiguous keys,
+    // including keys longer than the stack buffer of FragmentBuffer.
+    DeletableBloomFilter dbf(1000, 100, 0.0001, hashScheme);
+    ConcurrentDeletableBloomFilter concurrent(1000, 100, 0.0001, hashScheme);
+    DeletableBloomFilter raw(1000, 100, 0.0001, hashScheme);
+    for (int x = 0; x < 300; x++){
+        int len = x % 7 == 0 ? 300 + x : x % 40;
+        KeyFragment fragments[3] = {{data + x, len / 3}, {data + x + len / 3, 0},
+                                    {data + x + len / 3, len - len / 3}};
+        HashedKey key(fragments, 3, hashScheme, 32);
+        HashedKey expected(data + x, len, hashScheme, 32);
+        if (hashScheme == HASH_SCHEME_SEEDED){
+            for (uint i = 0; i < 32; i++){
+                assert(key.getSeeded(i) == expected.getSeeded(i));
+            }
+        }else{
+            assert(key.getHashes()[0] == expected.getHashes()[0]);
+            assert(key.getHashes()[1] == expected.getHashes()[1]);
+        }
+        if (x % 2){
+            assert(dbf.testAndAdd(fragments, 3) == raw.testAndAdd(data + x, len));
+            concurrent.add(fragments, 3);
+        }else{
+            assert(dbf.test(fragments, 3) == raw.test(data + x, len));
+            assert(concurrent.test(fragments, 3) == concurrent.test(data + x, len));
+        }
+        if (x % 5 == 0){
+            assert(dbf.testAndRemove(fragments, 3) == raw.testAndRemove(data + x, len));
+        }
+    }
+    assert(dbf.getCount() == raw.getCount());
+}
+
+static void testTypedKeys(HashScheme hashScheme){
+    // The integer hashes match those of the little-endian bytes.
+    for (uint64_t x : {(uint64_t) 0, (uint64_t) 1, (uint64_t) 0x12345678, (uint64_t) 0xdeadbeefcafef00dULL, ~(uint64_t) 0}){
+        uint32_t y = (uint32_t) x;
+        for (uint32_t seed : {0u, 7u, 0x9747b28cu}){
+            assert(MurmurHash3_x86_32_u32(y, seed) == MurmurHash3_x86_32((char*) &y, 4, seed));
+            assert(MurmurHash3_x86_32_u64(x, seed) == MurmurHash3_x86_32((char*) &x, 8, seed));
+            MurmurHash128 a = MurmurHash3_x64_128_u32(y, seed), b = MurmurHash3_x64_128((char*) &y, 4, seed);
+            assert(a.h1 == b.h1 && a.h2 == b.h2);
+            a = MurmurHash3_x64_128_u64(x, seed);
+            b = MurmurHash3_x64_128((char*) &x, 8, seed);
+            assert(a.h1 == b.h1 && a.h2 == b.h2);
+        }
+    }
+    static_assert(MurmurHash3_x86_32_u64(42, 0) == MurmurHash3_x86_32("\x2a\0\0\0\0\0\0\0", 8, 0),
+                  "constexpr integer hash");
+
+    // Integer and string_view keys set the same buckets as their bytes, with
+    // more hash functions than INDEXER_SEED_LANES.
+    DeletableBloomFilter dbf(1000, 100, 0.0001, hashScheme, false, 3);
+    ConcurrentDeletableBloomFilter concurrent(1000, 100, 0.0001, hashScheme, false, 3);
+    DeletableBloomFilter raw(1000, 100, 0.0001, hashScheme, false, 3);
+    for (uint64_t x = 0; x < 300; x++){
+        uint64_t key = x * 0x9e3779b97f4a7c15ULL;
+        uint32_t key32 = (uint32_t) key;
+        if (x % 2){
+            assert(dbf.testAndAdd(key) == raw.testAndAdd((const char*) &key, 8));
+            assert(dbf.testAndAdd(key32) == raw.testAndAdd((const char*) &key32, 4));
+            concurrent.add(key);
+            concurrent.add(key32);
+        }else{
+            assert(dbf.test(key) == raw.test((const char*) &key, 8));
+            assert(dbf.test(key32) == raw.test((const char*) &key32, 4));
+            assert(concurrent.test(key) == concurrent.test((const char*) &key, 8));
+            assert(concurrent.test(key32) == concurrent.test((const char*) &key32, 4));
+        }
+        if (x % 5 == 0){
+            assert(dbf.testAndRemove(key) == raw.testAndRemove((const char*) &key, 8));
+        }
+    }
+    for (uint64_t x = 1; x < 300; x += 2){
+        uint64_t key = x * 0x9e3779b97f4a7c15ULL;
+        assert(concurrent.test((const char*) &key, 8));
+    }
+    assert(dbf.getCount() == raw.getCount());
+
+    std::string s = "typed key";
+    dbf.add(s);
+    assert(dbf.test("typed key"));
+    assert(raw.test(s.data(), s.size()) == raw.test(std::string_view(s)));
+    assert(dbf.testAndRemove(std::string_view(s)));
+    concurrent.add(s);
+    assert(concurrent.test(s.c_str(), s.size()));
+    BlockedDeletableBloomFilter blocked(1000, 100, 0.0001);
+    blocked.add(std::string_view("typed key"));
+    assert(blocked.test(s.data(), s.size()));
+    assert(blocked.testAndRemove(s));
+
+#ifdef __cpp_lib_span
+    // Byte spans set the same buckets as their bytes.
+    std::string_view view("span key");
+    std::span<const std::byte> bytes = std::as_bytes(std::span<const char>(view.data(), view.size()));
+    uint64_t count = dbf.getCount();
+    assert(!dbf.testAndAdd(bytes));
+    assert(dbf.test(view) && dbf.test(bytes));
+    assert(dbf.testAndRemove(bytes) && dbf.getCount() == count);
+    concurrent.add(bytes);
+    assert(concurrent.test(view.data(), view.size()) && concurrent.testAndAdd(bytes));
+    assert(concurrent.testAndRemove(bytes) && concurrent.test(bytes));
+#endif
+}
+
+static void testSeed(HashScheme hashScheme){
+    uint64_t seed = randomSeed() | 1;
+    DeletableBloomFilter unseeded(1000, 100, 0.01, hashScheme);
+    DeletableBloomFilter seeded(1000, 100, 0.01, hashScheme, false, seed);
+    ConcurrentDeletableBloomFilter concurrent(1000, 100, 0.01, hashScheme, false, seed);
+    assert(unseeded.getSeed() == 0 && seeded.getSeed() == seed && concurrent.getSeed() == seed);
+
+    // Another seed gives other bucket indices.
+    uint64_t a[16], b[16];
+    uint differ = 0;
+    for (uint32_t x = 0; x < 100; x++){
+        unseeded.getIndexer().indices((char*) &x, 4, a);
+        seeded.getIndexer().indices((char*) &x, 4, b);
+        differ += memcmp(a, b, unseeded.getIndexer().getK() * sizeof(uint64_t)) != 0;
+    }
+    assert(differ > 95);
+
+    for (uint32_t x = 0; x < 1000; x += 2){
+        seeded.add((char*) &x, 4);
+        concurrent.add(HashedKey((char*) &x, 4, hashScheme, HASHED_KEY_SEEDS, seed));
+    }
+    for (uint32_t x = 0; x < 1000; x += 2){
+        assert(seeded.test((char*) &x, 4));
+        assert(concurrent.test((char*) &x, 4));
+    }
+
+    // Keys hashed with another seed are rejected.
+    uint32_t x = 1;
+    bool thrown = false;
+    try{
+        seeded.test(HashedKey((char*) &x, 4, hashScheme));
+    }catch (const std::invalid_argument&){
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Snapshots keep the seed.
+    const char* path = "test-seed.dbf";
+    seeded.save(path);
+    DeletableBloomFilter loaded = DeletableBloomFilter::load(path);
+    remove(path);
+    assert(loaded.getSeed() == seed);
+    for (uint32_t x = 0; x < 2000; x++){
+        assert(loaded.test((char*) &x, 4) == seeded.test((char*) &x, 4));
+    }
+
+    BlockedDeletableBloomFilter blocked(1000, 100, 0.01, seed);
+    assert(blocked.getSeed() == seed);
+    for (uint32_t x = 0; x < 1000; x += 2){
+        blocked.add((char*) &x, 4);
+    }
+    for (uint32_t x = 0; x < 1000; x += 2){
+        assert(blocked.test((char*) &x, 4));
+    }
+}
+
+template <HashScheme S>
+static void testFixed(){
+    static_assert(fixedHashes(0.01) == 7, "fixedHashes is not constexpr");
+    double rates[] = {0.1, 0.01, 0.001, 1e-6};
+    for (double p : rates){
+        assert(fixedHashes(p) == DeletableBloomFilter::optimalK(p));
+        for (uint64_t n : {1, 1000, 123457, 100000000}){
+            assert(fixedBuckets(n, 0, p) == DeletableBloomFilter::optimalM(n, p));
+        }
+    }
+
+    // Same bits as the DeletableBloomFilter of the same geometry.
+    FixedDeletableBloomFilter<fixedBuckets(1000, 64, 0.01), fixedHashes(0.01), 64, S> fixed;
+    DeletableBloomFilter dbf(1000, 64, 0.01, S);
+    for (uint32_t x = 0; x < 1000; x++){
+        assert(fixed.testAndAdd((char*) &x, 4) == dbf.testAndAdd((char*) &x, 4));
+    }
+    for (uint32_t x = 0; x < 3000; x++){
+        assert(fixed.test((char*) &x, 4) == dbf.test((char*) &x, 4));
+        assert(fixed.test(HashedKey((char*) &x, 4, S)) == dbf.test((char*) &x, 4));
+    }
+    for (uint32_t x = 0; x < 3000; x += 3){
+        assert(fixed.testAndRemove((char*) &x, 4) == dbf.testAndRemove((char*) &x, 4));
+    }
+    assert(fixed.getCount() == dbf.getCount());
+    for (uint32_t x = 0; x < 3000; x++){
+        assert(fixed.test((char*) &x, 4) == dbf.test((char*) &x, 4));
+    }
+    fixed.reset();
+    uint32_t x = 1;
+    assert(!fixed.test((char*) &x, 4) && fixed.getCount() == 0);
+
+    // A seeded filter sets the bits of the DeletableBloomFilter with that seed.
+    uint64_t seed = randomSeed() | 1;
+    FixedDeletableBloomFilter<fixedBuckets(1000, 64, 0.01), fixedHashes(0.01), 64, S> keyed(seed);
+    DeletableBloomFilter seeded(1000, 64, 0.01, S, false, seed);
+    assert(keyed.getSeed() == seed);
+    for (x = 0; x < 1000; x += 2){
+        keyed.add((char*) &x, 4);
+        seeded.add((char*) &x, 4);
+    }
+    for (x = 0; x < 3000; x++){
+        assert(keyed.test((char*) &x, 4) == seeded.test((char*) &x, 4));
+    }
+    assert(keyed.test(HashedKey("\0\0\0\0", 4, S, HASHED_KEY_SEEDS, seed)));
+    bool thrown = false;
+    try{
+        keyed.test(HashedKey("\0\0\0\0", 4, S));
+    }catch (const std::invalid_argument&){
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+static void testBuildFrom(HashScheme hashScheme){
+    // Enough keys for several rounds of BUILD_CHUNK keys per thread.
+    const uint32_t n = 3 * BUILD_CHUNK;
+    std::vector<uint32_t> values(n);
+    std::vector<DeletableBloomFilter::Key> keys(n);
+    for (uint32_t i = 0; i < n; i++){
+        values[i] = i;
+        keys[i] = {(char*) &values[i], 4};
+    }
+    for (uint threads : {1u, 3u, 4u}){
+        DeletableBloomFilter dbf(n + 1000, 20000, 0.01, hashScheme);
+        DeletableBloomFilter serial(n + 1000, 20000, 0.01, hashScheme);
+        uint32_t x;
+        // Items added before are collided with as by serial Adds.
+        for (x = n; x < n + 1000; x++){
+            dbf.add((char*) &x, 4);
+            serial.add((char*) &x, 4);
+        }
+        dbf.buildFrom(keys.data(), n, threads);
+        for (x = 0; x < n; x++){
+            serial.add((char*) &x, 4);
+        }
+        assert(dbf.getCount() == serial.getCount());
+        for (x = 0; x < 2 * n; x++){
+            assert(dbf.test((char*) &x, 4) == serial.test((char*) &x, 4));
+        }
+        for (x = 0; x < n; x += 2){
+            assert(dbf.testAndRemove((char*) &x, 4) == serial.testAndRemove((char*) &x, 4));
+        }
+        for (x = 0; x < 2 * n; x++){
+            assert(dbf.test((char*) &x, 4) == serial.test((char*) &x, 4));
+        }
+    }
+}
+
+static void testConcurrent(HashScheme hashScheme){
+    ConcurrentDeletableBloomFilter dbf(4000, 400, 0.01, hashScheme);
+    DeletableBloomFilter serial(4000, 400, 0.01, hashScheme);
+    std::vector<std::thread> threads;
+    uint32_t x;
+
+    // Keys 0..1999 are added by four threads, then the even ones are removed
+    // while keys 2000..3999 are being added.
+    for (uint32_t t = 0; t < 4; t++){
+        threads.emplace_back([&dbf, t](){
+            for (uint32_t y = t; y < 2000; y += 4){
+                dbf.add((char*) &y, 4);
+            }
+        });
+    }
+    for (std::thread& t : threads){
+        t.join();
+    }
+    threads.clear();
+    assert(dbf.getCount() == 2000);
+    for (x = 0; x < 2000; x++){
+        serial.add((char*) &x, 4);
+    }
+    for (x = 0; x < 4000; x++){
+        assert(dbf.test((char*) &x, 4) == serial.test((char*) &x, 4));
+    }
+
+    for (uint32_t t = 0; t < 4; t++){
+        threads.emplace_back([&dbf, t](){
+            for (uint32_t y = 2 * t; y < 2000; y += 8){
+                assert(dbf.testAndRemove((char*) &y, 4));
+            }
+        });
+        threads.emplace_back([&dbf, t](){
+            for (uint32_t y = 2000 + t; y < 4000; y += 4){
+                dbf.testAndAdd((char*) &y, 4);
+            }
+        });
+    }
+    for (std::thread& t : threads){
+        t.join();
+    }
+    assert(dbf.getCount() == 3000);
+    for (x = 1; x < 4000; x += x < 2000 ? 2 : 1){
+        TEST_UINT32_SUCCESS(x);
+    }
+}
+
+static void testWriteBuffer(HashScheme hashScheme){
+    ConcurrentDeletableBloomFilter dbf(4000, 400, 0.01, hashScheme);
+    DeletableBloomFilter serial(4000, 400, 0.01, hashScheme);
+    std::vector<std::thread> threads;
+    uint32_t x;
+
+    // The buffered items are only visible once flushed.
+    {
+        ConcurrentDeletableBloomFilter::WriteBuffer buffer(dbf);
+        x = 7;
+        buffer.add((char*) &x, 4);
+        assert(buffer.getPending() == 1);
+        assert(!dbf.test((char*) &x, 4));
+        buffer.flush();
+        assert(buffer.getPending() == 0);
+        assert(dbf.test((char*) &x, 4));
+        x = 8;
+        buffer.add(std::string_view((char*) &x, 4));
+    }
+    assert(dbf.test((char*) &x, 4));
+    assert(dbf.getCount() == 2);
+    dbf.reset();
+
+    // Keys 0..3999 are added by four threads through small buffers, merged
+    // many times. The collisions must be those of the serial filter for the
+    // removals to agree.
+    for (uint32_t t = 0; t < 4; t++){
+        threads.emplace_back([&dbf, t, hashScheme](){
+            ConcurrentDeletableBloomFilter::WriteBuffer buffer(dbf, 64);
+            for (uint32_t y = t; y < 4000; y += 4){
+                if (y % 3){
+                    buffer.add((char*) &y, 4);
+                }else{
+                    buffer.add(HashedKey((char*) &y, 4, hashScheme));
+                }
+            }
+        });
+    }
+    for (std::thread& t : threads){
+        t.join();
+    }
+    assert(dbf.getCount() == 4000);
+    for (x = 0; x < 4000; x++){
+        serial.add((char*) &x, 4);
+    }
+    for (x = 0; x < 8000; x++){
+        assert(dbf.test((char*) &x, 4) == serial.test((char*) &x, 4));
+    }
+    for (x = 0; x < 4000; x += 2){
+        assert(dbf.testAndRemove((char*) &x, 4) == serial.testAndRemove((char*) &x, 4));
+    }
+    for (x = 0; x < 8000; x++){
+        assert(dbf.test((char*) &x, 4) == serial.test((char*) &x, 4));
+    }
+}
+
+static void testSharded(HashScheme hashScheme){
+    ShardedDeletableBloomFilter dbf(4000, 400, 0.01, 8, hashScheme);
+    ShardedDeletableBloomFilter batched(4000, 400, 0.01, 8, hashScheme);
+    std::vector<std::thread> threads;
+    uint32_t x;
+
+    // Keys 0..3999 are added by four threads, then the even ones below 2000
+    // are removed by four others.
+    for (uint32_t t = 0; t < 4; t++){
+        threads.emplace_back([&dbf, t](){
+            for (uint32_t y = t; y < 4000; y += 4){
+                dbf.add((char*) &y, 4);
+            }
+        });
+    }
+    for (std::thread& t : threads){
+        t.join();
+    }
+    threads.clear();
+    assert(dbf.getCount() == 4000);
+    for (uint32_t t = 0; t < 4; t++){
+        threads.emplace_back([&dbf, t](){
+            for (uint32_t y = 2 * t; y < 2000; y += 8){
+                assert(dbf.testAndRemove((char*) &y, 4));
+            }
+        });
+    }
+    for (std::thread& t : threads){
+        t.join();
+    }
+    assert(dbf.getCount() == 3000);
+    for (x = 1; x < 4000; x += x < 2000 ? 2 : 1){
+        TEST_UINT32_SUCCESS(x);
+    }
+
+    // The shards are sized for their share of the items, the false-positive
+    // rate is that of the whole filter.
+    uint32_t fp = 0;
+    for (x = 100000; x < 200000; x++){
+        fp += dbf.test((char*) &x, 4);
+    }
+    assert(fp < 2000);
+
+    // The batch operations give the same results as single calls in order.
+    std::vector<uint32_t> ids(6000);
+    std::vector<DeletableBloomFilter::Key> keys(6000);
+    for (x = 0; x < 6000; x++){
+        ids[x] = x % 3 == 0 ? x / 3 : x;
+        keys[x] = {(const char*) &ids[x], 4};
+    }
+    batched.addBatch(keys.data(), 4000);
+    std::vector<uint8_t> results(6000);
+    batched.removeBatch(keys.data() + 4000, 2000, results.data());
+    ShardedDeletableBloomFilter serial(4000, 400, 0.01, 8, hashScheme);
+    for (x = 0; x < 4000; x++){
+        serial.add(keys[x].data, 4);
+    }
+    for (x = 4000; x < 6000; x++){
+        assert(results[x - 4000] == serial.testAndRemove(keys[x].data, 4));
+    }
+    assert(batched.getCount() == serial.getCount());
+    batched.testBatch(keys.data(), 6000, results.data());
+    for (x = 0; x < 6000; x++){
+        assert(results[x] == serial.test(keys[x].data, 4));
+    }
+
+    HashedKey key = dbf.hashKey("key", 3);
+    dbf.add(key);
+    assert(dbf.test(std::string_view("key")));
+    if (hashScheme == HASH_SCHEME_SEEDED){
+        bool thrown = false;
+        try{
+            dbf.test(HashedKey("key", 3, hashScheme, DeletableBloomFilter::optimalK(0.01)));
+        }catch (const std::invalid_argument&){
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    bool thrown = false;
+    try{
+        ShardedDeletableBloomFilter empty(4000, 400, 0.01, 0, hashScheme);
+    }catch (const std::invalid_argument&){
+        thrown = true;
+    }
+    assert(thrown);
+    dbf.reset();
+    assert(dbf.getCount() == 0);
+}
+
+static void testEpoch(HashScheme hashScheme){
+    EpochDeletableBloomFilter dbf(4000, 400, 0.01, hashScheme);
+    DeletableBloomFilter serial(4000, 400, 0.01, hashScheme);
+    EpochDeletableBloomFilter::Reader reader(dbf);
+    uint32_t x;
+
+    // The writer sees its updates at once, the readers after Publish.
+    for (x = 0; x < 2000; x++){
+        assert(dbf.testAndAdd((char*) &x, 4) == serial.testAndAdd((char*) &x, 4));
+    }
+    x = 7;
+    assert(dbf.test((char*) &x, 4));
+    assert(!reader.test((char*) &x, 4));
+    dbf.publish();
+    for (x = 0; x < 4000; x++){
+        assert(reader.test((char*) &x, 4) == serial.test((char*) &x, 4));
+    }
+    for (x = 0; x < 2000; x += 2){
+        assert(dbf.testAndRemove((char*) &x, 4) == serial.testAndRemove((char*) &x, 4));
+    }
+    assert(dbf.getCount() == serial.getCount());
+    assert(reader.test(HashedKey("\0\0\0\0", 4, hashScheme)));
+    dbf.publish();
+    for (x = 0; x < 4000; x++){
+        assert(reader.test((char*) &x, 4) == serial.test((char*) &x, 4));
+        assert(dbf.test((char*) &x, 4) == serial.test((char*) &x, 4));
+    }
+
+    // Readers run while the writer adds and publishes: the keys published
+    // before a lookup starts are always found.
+    std::atomic<uint32_t> published(2000);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; t++){
+        threads.emplace_back([&dbf, &published, &done](){
+            EpochDeletableBloomFilter::Reader reader(dbf);
+            while (!done.load()){
+                uint32_t end = published.load();
+                for (uint32_t y = 2001; y < end; y += 2){
+                    assert(reader.test((char*) &y, 4));
+                }
+            }
+        });
+    }
+    for (x = 2000; x < 4000; x++){
+        dbf.add((char*) &x, 4);
+        if (x % 100 == 99){
+            dbf.publish();
+            published.store(x + 1);
+        }
+    }
+    done.store(true);
+    for (std::thread& t : threads){
+        t.join();
+    }
+    assert(dbf.reclaim() == 0);
+
+    bool thrown = false;
+    try{
+        std::vector<std::unique_ptr<EpochDeletableBloomFilter::Reader>> readers;
+        for (int i = 0; i <= EPOCH_READER_SLOTS; i++){
+            readers.emplace_back(new EpochDeletableBloomFilter::Reader(dbf));
+        }
+    }catch (const std::runtime_error&){
+        thrown = true;
+    }
+    assert(thrown);
+
+    dbf.reset();
+    assert(reader.test(std::string_view("\x01\0\0\0", 4)));
+    dbf.publish();
+    assert(!reader.test(std::string_view("\x01\0\0\0", 4)));
+    assert(dbf.getCount() == 0);
+
+    // Reset with both dirty and clean pages.
+    dbf.add(std::string_view("\x02\0\0\0", 4));
+    dbf.reset();
+    dbf.publish();
+    assert(!reader.test(std::string_view("\x02\0\0\0", 4)));
+}
+
+static void testNuma(HashScheme hashScheme){
+    NumaDeletableBloomFilter dbf(4000, 400, 0.01, hashScheme);
+    DeletableBloomFilter serial(4000, 400, 0.01, hashScheme);
+    std::vector<std::thread> threads;
+    uint32_t x;
+
+    // Every replica holds the same buckets as the serial filter.
+    for (uint32_t t = 0; t < 4; t++){
+        threads.emplace_back([&dbf, t](){
+            for (uint32_t y = t; y < 4000; y += 4){
+                dbf.add((char*) &y, 4);
+            }
+        });
+    }
+    for (std::thread& t : threads){
+        t.join();
+    }
+    assert(dbf.getCount() == 4000);
+    for (x = 0; x < 4000; x++){
+        serial.add((char*) &x, 4);
+    }
+    for (x = 0; x < 4000; x += 2){
+        assert(dbf.testAndRemove((char*) &x, 4) == serial.testAndRemove((char*) &x, 4));
+    }
+    assert(dbf.getCount() == serial.getCount());
+    for (x = 0; x < 8000; x++){
+        assert(dbf.test((char*) &x, 4) == serial.test((char*) &x, 4));
+        for (uint i = 0; i < dbf.getReplicas(); i++){
+            assert(dbf.testReplica(i, (char*) &x, 4) == serial.test((char*) &x, 4));
+        }
+    }
+    assert(dbf.test(HashedKey("\x01\0\0\0", 4, hashScheme)));
+    assert(dbf.test(std::string_view("\x03\0\0\0", 4)));
+
+    bool thrown = false;
+    try{
+        dbf.testReplica(dbf.getReplicas(), (char*) &x, 4);
+    }catch (const std::out_of_range&){
+        thrown = true;
+    }
+    assert(thrown);
+
+    dbf.reset();
+    assert(!dbf.test(std::string_view("\x01\0\0\0", 4)));
+    assert(dbf.getCount() == 0);
+
+    // Keys 0..1999 are added, then the even ones are removed while keys
+    // 2000..3999 are being added. Three replicas are forced, on one node if
+    // there is only one, and must end up holding the same buckets. The regions
+    // are small, so that most removals clear buckets the adds race on.
+    NumaDeletableBloomFilter replicated(4000, 4000, 0.01, hashScheme, false, 0, 3);
+    assert(replicated.getReplicas() == 3);
+    threads.clear();
+    for (x = 0; x < 2000; x++){
+        replicated.add((char*) &x, 4);
+    }
+    for (uint32_t t = 0; t < 4; t++){
+        threads.emplace_back([&replicated, t](){
+            for (uint32_t y = 2 * t; y < 2000; y += 8){
+                assert(replicated.testAndRemove((char*) &y, 4));
+            }
+        });
+        threads.emplace_back([&replicated, t](){
+            for (uint32_t y = 2000 + t; y < 4000; y += 4){
+                replicated.testAndAdd((char*) &y, 4);
+            }
+        });
+    }
+    for (std::thread& t : threads){
+        t.join();
+    }
+    assert(replicated.getCount() == 3000);
+    for (x = 0; x < 8000; x++){
+        bool member = replicated.testReplica(0, (char*) &x, 4);
+        assert(member || (x < 2000 && x % 2 == 0) || x >= 4000);
+        for (uint i = 1; i < replicated.getReplicas(); i++){
+            assert(replicated.testReplica(i, (char*) &x, 4) == member);
+        }
+    }
+}
+
+static void testSnapshot(HashScheme hashScheme){
+    const char* path = "test-snapshot.dbf";
+    DeletableBloomFilter original(1000, 100, 0.01, hashScheme);
+    uint32_t x;
+    for (x = 0; x < 1000; x += 2){
+        original.add((char*) &x, 4);
+    }
+    original.save(path);
+
+    DeletableBloomFilter loaded = DeletableBloomFilter::load(path);
+    DeletableBloomFilter mapped = DeletableBloomFilter::openMapped(path, true);
+    assert(loaded.getCount() == 500 && mapped.getCount() == 500);
+    assert(loaded.getHashScheme() == hashScheme && mapped.getHashScheme() == hashScheme);
+    for (x = 0; x < 2000; x++){
+        bool member = original.test((char*) &x, 4);
+        assert(loaded.test((char*) &x, 4) == member);
+        assert(mapped.test((char*) &x, 4) == member);
+    }
+
+    // Changes to a mapped filter are private to it.
+    for (x = 0; x < 1000; x += 2){
+        assert(mapped.testAndRemove((char*) &x, 4));
+    }
+    DeletableBloomFilter copy = mapped;
+    mapped = DeletableBloomFilter::openMapped(path);
+    for (x = 0; x < 1000; x += 2){
+        assert(mapped.test((char*) &x, 4));
+    }
+    assert(copy.getCount() == 0);
+
+    // A corrupted snapshot is rejected by the checksum.
+    FILE* f = fopen(path, "r+b");
+    fseek(f, -1, SEEK_END);
+    int last = fgetc(f);
+    fseek(f, -1, SEEK_END);
+    fputc(last ^ 1, f);
+    fclose(f);
+    bool rejected = false;
+    try{
+        DeletableBloomFilter::load(path);
+    }catch (const std::runtime_error&){
+        rejected = true;
+    }
+    assert(rejected);
+
+    // Concurrent saves to the same path each write their own temporary file.
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++){
+        threads.emplace_back([&original, path](){
+            for (int i = 0; i < 10; i++){
+                original.save(path);
+            }
+        });
+    }
+    for (std::thread& t : threads){
+        t.join();
+    }
+    assert(DeletableBloomFilter::load(path).getCount() == 500);
+
+    // A snapshot of the other byte order is rejected by its marker.
+    SnapshotHeader header;
+    f = fopen(path, "r+b");
+    assert(fread(&header, sizeof(header), 1, f) == 1);
+    header.byteOrder = __builtin_bswap64(header.byteOrder);
+    fseek(f, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, f);
+    fclose(f);
+    rejected = false;
+    try{
+        DeletableBloomFilter::openMapped(path);
+    }catch (const std::runtime_error& e){
+        rejected = strstr(e.what(), "byte order") != NULL;
+    }
+    assert(rejected);
+
+    // A header whose sizes would wrap around is rejected, even when mapped
+    // without verifying the checksum.
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.hashScheme = HASH_SCHEME_DOUBLE;
+    header.m = UINT64_MAX - 10;
+    header.r = 1;
+    header.regionSize = header.m;
+    header.bucketWords = 0;
+    header.collisionWords = 1;
+    f = fopen(path, "wb");
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(&header.m, sizeof(uint64_t), 1, f);
+    fclose(f);
+    rejected = false;
+    try{
+        DeletableBloomFilter::openMapped(path);
+    }catch (const std::runtime_error& e){
+        rejected = strstr(e.what(), "Corrupted") != NULL;
+    }
+    assert(rejected);
+    remove(path);
+}
+
+int main(int argc, char** argv){
+    testBitset();
+    testDivisor();
+    testHashSimd();
+    testHashEngines();
+    testWide();
+    testBasic(HASH_SCHEME_SEEDED);
+    testBasic(HASH_SCHEME_DOUBLE);
+    testBasic(HASH_SCHEME_SEEDED, true);
+    testBasic(HASH_SCHEME_DOUBLE, true);
+    testBatch(HASH_SCHEME_SEEDED);
+    testBatch(HASH_SCHEME_DOUBLE);
+    testBlocked();
+    testHashedKey(HASH_SCHEME_SEEDED);
+    testHashedKey(HASH_SCHEME_DOUBLE);
+    testConstexprHash();
+    testFragments(HASH_SCHEME_SEEDED);
+    testFragments(HASH_SCHEME_DOUBLE);
+    testTypedKeys(HASH_SCHEME_SEEDED);
+    testTypedKeys(HASH_SCHEME_DOUBLE);
+    testFixed<HASH_SCHEME_SEEDED>();
+    testFixed<HASH_SCHEME_DOUBLE>();
+    testFixed<HASH_SCHEME_SIPHASH>();
+    testBuildFrom(HASH_SCHEME_SEEDED);
+    testBuildFrom(HASH_SCHEME_DOUBLE);
+    testConcurrent(HASH_SCHEME_SEEDED);
+    testConcurrent(HASH_SCHEME_DOUBLE);
+    testWriteBuffer(HASH_SCHEME_SEEDED);
+    testWriteBuffer(HASH_SCHEME_DOUBLE);
+    testSharded(HASH_SCHEME_SEEDED);
+    testSharded(HASH_SCHEME_DOUBLE);
+    testEpoch(HASH_SCHEME_SEEDED);
+    testEpoch(HASH_SCHEME_DOUBLE);
+    testNuma(HASH_SCHEME_SEEDED);
+    testNuma(HASH_SCHEME_DOUBLE);
+    testSnapshot(HASH_SCHEME_SEEDED);
+    testSnapshot(HASH_SCHEME_DOUBLE);
+    testSeed(HASH_SCHEME_SEEDED);
+    testSeed(HASH_SCHEME_DOUBLE);
+    for (HashScheme hashScheme : {HASH_SCHEME_WYHASH, HASH_SCHEME_CRC32C, HASH_SCHEME_XXH3, HASH_SCHEME_SIPHASH}){
+        if (hashSchemeSupported(hashScheme)){
+            testBasic(hashScheme);
+            testBatch(hashScheme);
+            testSnapshot(hashScheme);
+            testFragments(hashScheme);
+            testTypedKeys(hashScheme);
+            testSeed(hashScheme);
+        }
+    }
+}